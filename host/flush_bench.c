@@ -0,0 +1,180 @@
+/*
+ * flush_bench - counts the handshakes and Gate Array register accesses a flush of the
+ * command queue costs, comparing scd_flush_cmd_queue with the original path that sent
+ * every queued command through its own blocking handshake between two 'E' suspends
+ *
+ * Build: gcc -O2 -Ihost -Iinc -o flush_bench host/hw_sim.c host/rf5c164.c host/scd_drv_sim.c
+ *            src/scd_pcm.c src/hw_scd.c host/flush_bench.c
+ * Usage: flush_bench [ack_wait_cycles]
+ *
+ * Main CPU cycles can't be measured on the host, so they are estimated from the counts:
+ * every register access costs CYCLES_PER_ACCESS, and every handshake costs ack_wait_cycles
+ * on top for the time the 68000 spends polling until the Sub-CPU acknowledges, which the
+ * simulated driver does at once. The wait depends on what the Sub-CPU is doing, so pass
+ * a figure measured on hardware to replace the default. Both paths have to leave the chip
+ * in the same state, the exit status is non-zero if they don't
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hw_sim.h"
+#include "scd_drv_sim.h"
+#include "scd_pcm.h"
+
+#define MAX_OPS 16
+
+// 68000 cycles of a move.b or move.w to or from an absolute long address
+#define CYCLES_PER_ACCESS 16
+// assumed Sub-CPU response time per handshake, about 0.26 ms at 7.67 MHz
+#define DEFAULT_ACK_WAIT_CYCLES 2000
+
+typedef struct
+{
+    char cmd;   // 'A', 'U', 'O' or 'L'
+    u8 src_id;
+    u8 vol;
+} op_t;
+
+typedef struct
+{
+    const char *name;
+    u8 num_ops;
+    op_t ops[MAX_OPS];
+} scenario_t;
+
+typedef struct
+{
+    u32 handshakes;
+    u32 accesses;
+    u8 env[RF5C164_CHANNELS];   // chip state afterwards, 0 for channels that are off
+} result_t;
+
+static const scenario_t scenarios[] = {
+    { "1 update", 1, { {'U', 1, 10} } },
+    { "8 updates, one per source", 8, {
+        {'U', 1, 10}, {'U', 2, 20}, {'U', 3, 30}, {'U', 4, 40},
+        {'U', 5, 50}, {'U', 6, 60}, {'U', 7, 70}, {'U', 8, 80} } },
+    { "16 updates, two per source", 16, {
+        {'U', 1, 10}, {'U', 2, 20}, {'U', 3, 30}, {'U', 4, 40},
+        {'U', 5, 50}, {'U', 6, 60}, {'U', 7, 70}, {'U', 8, 80},
+        {'U', 1, 11}, {'U', 2, 21}, {'U', 3, 31}, {'U', 4, 41},
+        {'U', 5, 51}, {'U', 6, 61}, {'U', 7, 71}, {'U', 8, 81} } },
+    { "8 updates, unchanged values", 8, {
+        {'U', 1, 100}, {'U', 2, 100}, {'U', 3, 100}, {'U', 4, 100},
+        {'U', 5, 100}, {'U', 6, 100}, {'U', 7, 100}, {'U', 8, 100} } },
+    { "restarts and stops", 8, {
+        {'A', 1, 10}, {'U', 1, 20}, {'A', 1, 30}, {'O', 2, 0},
+        {'A', 2, 40}, {'U', 3, 50}, {'O', 3, 0}, {'U', 4, 60} } },
+    { "clear, then 4 plays", 8, {
+        {'U', 1, 10}, {'U', 2, 20}, {'O', 3, 0}, {'L', 0, 0},
+        {'A', 1, 30}, {'A', 2, 40}, {'A', 3, 50}, {'A', 4, 60} } },
+};
+
+static u8 tone_wav[44 + 1000];
+static rf5c164_t chip;
+
+// the original flush: suspend, one blocking handshake per command, resume
+static void flush_old(const scenario_t *sc)
+{
+    const op_t *op;
+    u8 i;
+
+    scd_cmd_wait(scd_cmd_submit('E', 1<<24, 0, 0));
+    for (i = 0, op = sc->ops; i < sc->num_ops; i++, op++) {
+        switch (op->cmd) {
+            case 'A':
+                scd_cmd_wait(scd_cmd_submit('A', ((u32)op->src_id<<16)|1, 255, (u32)op->vol<<16|1));
+                break;
+            case 'U':
+                scd_cmd_wait(scd_cmd_submit('U', (u32)op->src_id<<16, 255, (u32)op->vol<<16|1));
+                break;
+            case 'O':
+                scd_cmd_wait(scd_cmd_submit('O', (u32)op->src_id<<16, 0, 0));
+                break;
+            default:
+                scd_cmd_wait(scd_cmd_submit('L', 0, 0, 0));
+                break;
+        }
+    }
+    scd_cmd_wait(scd_cmd_submit('E', 0, 0, 0));
+}
+
+static void flush_new(const scenario_t *sc)
+{
+    const op_t *op;
+    u8 i;
+
+    for (i = 0, op = sc->ops; i < sc->num_ops; i++, op++) {
+        switch (op->cmd) {
+            case 'A':
+                scd_queue_play_src(op->src_id, 1, 0, 255, op->vol, 1);
+                break;
+            case 'U':
+                scd_queue_update_src(op->src_id, 0, 255, op->vol, 1);
+                break;
+            case 'O':
+                scd_queue_stop_src(op->src_id);
+                break;
+            default:
+                scd_queue_clear_pcm();
+                break;
+        }
+    }
+    scd_flush_cmd_queue();
+}
+
+static void run(const scenario_t *sc, void (*flush)(const scenario_t *), result_t *res)
+{
+    scd_drv_sim_stats_t before, after;
+    u32 accesses;
+    u8 i;
+
+    // every scenario starts with all sources playing at volume 100
+    hw_sim_reset();
+    scd_drv_sim_install(&chip);
+    scd_init_pcm();
+    scd_upload_buf(1, tone_wav, sizeof(tone_wav));
+    for (i = 1; i <= SCD_MAX_SRCS; i++)
+        scd_src_play(i, 1, 0, 255, 100, 1);
+
+    scd_drv_sim_get_stats(&before);
+    accesses = hw_sim_access_count();
+    flush(sc);
+    scd_drv_sim_get_stats(&after);
+
+    res->handshakes = after.cmds - before.cmds;
+    res->accesses = hw_sim_access_count() - accesses;
+    for (i = 0; i < RF5C164_CHANNELS; i++)
+        res->env[i] = (chip.chan_off & (1 << i)) ? 0 : chip.ch[i].env;
+}
+
+int main(int argc, char **argv)
+{
+    result_t old_res, new_res;
+    u32 i, ack_wait = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_ACK_WAIT_CYCLES;
+    int errors = 0;
+
+    memcpy(tone_wav, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x01\0\x80\x3e\0\0\x80\x3e\0\0\x01\0\x08\0data", 40);
+    tone_wav[4] = (36 + 1000) & 0xff;
+    tone_wav[5] = (36 + 1000) >> 8;
+    tone_wav[40] = 1000 & 0xff;
+    tone_wav[41] = 1000 >> 8;
+    for (i = 0; i < 1000; i++)
+        tone_wav[44 + i] = i & 16 ? 0xA0 : 0x60;
+
+    printf("estimated cycles: %u per register access, %u per handshake for the acknowledge\n\n",
+        CYCLES_PER_ACCESS, ack_wait);
+    printf("%-30s %21s %21s %21s\n", "", "handshakes", "register accesses", "estimated cycles");
+    printf("%-30s %10s %10s %10s %10s %10s %10s\n", "scenario", "old", "new", "old", "new", "old", "new");
+    for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        run(scenarios + i, flush_old, &old_res);
+        run(scenarios + i, flush_new, &new_res);
+        printf("%-30s %10u %10u %10u %10u %10u %10u%s\n", scenarios[i].name,
+            old_res.handshakes, new_res.handshakes, old_res.accesses, new_res.accesses,
+            old_res.accesses * CYCLES_PER_ACCESS + old_res.handshakes * ack_wait,
+            new_res.accesses * CYCLES_PER_ACCESS + new_res.handshakes * ack_wait,
+            memcmp(old_res.env, new_res.env, sizeof(old_res.env)) ? "  state differs" : "");
+        if (memcmp(old_res.env, new_res.env, sizeof(old_res.env)))
+            errors++;
+    }
+    return errors ? 1 : 0;
+}
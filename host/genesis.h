@@ -0,0 +1,36 @@
+/*
+ * Minimal stand-in for the SGDK genesis.h used by host builds of the driver
+ * interface code, see host/hw_sim.c
+ */
+#ifndef _HOST_GENESIS_H
+#define _HOST_GENESIS_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#ifndef __cplusplus
+typedef u8 bool;
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+typedef void VoidCallback(void);
+
+// VBlank emulation provided by host/hw_sim.c
+void SYS_setVIntCallback(VoidCallback *CB);
+void SYS_doVBlankProcess(void);
+
+// simulated clock, advances 1280 subticks per VBlank and 1 per Gate Array access
+u32 getSubTick(void);
+
+#endif // _HOST_GENESIS_H
@@ -0,0 +1,131 @@
+/*
+ * Host simulation of the Sega CD Gate Array as seen from the main CPU
+ *
+ * Build the driver interface for the PC together with this file, e.g.:
+ * gcc -Ihost -Iinc host/hw_sim.c src/scd_pcm.c src/hw_scd.c test.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <genesis.h>
+#include "hw_sim.h"
+#include "../inc/hw_md.h"
+#include "../res/resources.h"
+
+volatile unsigned char hw_sim_ga[0x30];
+
+static unsigned char hw_sim_ram[HW_SIM_MEM_SIZE] __attribute__((aligned(4)));
+static void (*hw_sim_sub)(void);
+static VoidCallback *hw_sim_vint;
+static unsigned int hw_sim_accesses;
+static u32 hw_sim_subticks;
+
+// the driver image isn't needed as nothing executes it on the host
+const u8 scd_fusion_driver[12816];
+
+void Kos_Decomp(u8 *src, u8 *dst)
+{
+    // the Sub-CPU BIOS isn't simulated
+    (void)src;
+    (void)dst;
+}
+
+void hw_sim_reset(void)
+{
+    memset((void *)hw_sim_ga, 0, sizeof(hw_sim_ga));
+    memset(hw_sim_ram, 0, sizeof(hw_sim_ram));
+    hw_sim_accesses = 0;
+    hw_sim_subticks = 0;
+}
+
+void hw_sim_set_sub_handler(void (*handler)(void))
+{
+    hw_sim_sub = handler;
+}
+
+unsigned int hw_sim_access_count(void)
+{
+    return hw_sim_accesses;
+}
+
+void *hw_sim_mem(unsigned int addr)
+{
+    if (addr < HW_SIM_MEM_BASE || addr >= HW_SIM_MEM_BASE + HW_SIM_MEM_SIZE) {
+        fprintf(stderr, "hw_sim: access to unmapped address %06X\n", addr);
+        abort();
+    }
+    return hw_sim_ram + (addr - HW_SIM_MEM_BASE);
+}
+
+static volatile unsigned char *hw_sim_reg(unsigned int addr)
+{
+    if (addr >= 0xA12000 && addr < 0xA12030) {
+        hw_sim_accesses++;
+        hw_sim_subticks++;
+        return hw_sim_ga + (addr - 0xA12000);
+    }
+    return (volatile unsigned char *)hw_sim_mem(addr);
+}
+
+static void hw_sim_sync(unsigned int addr)
+{
+    if (addr >= 0xA12000 && addr < 0xA12030 && hw_sim_sub)
+        hw_sim_sub();
+}
+
+void write_byte(unsigned int dst, unsigned char val)
+{
+    // the sub comm flag and status registers are read-only for the main CPU
+    if (dst != 0xA1200F && !(dst >= 0xA12020 && dst < 0xA12030))
+        *hw_sim_reg(dst) = val;
+    hw_sim_sync(dst);
+}
+
+void write_word(unsigned int dst, unsigned short val)
+{
+    write_byte(dst, val >> 8);
+    write_byte(dst + 1, val);
+}
+
+void write_long(unsigned int dst, unsigned int val)
+{
+    write_word(dst, val >> 16);
+    write_word(dst + 2, val);
+}
+
+unsigned char read_byte(unsigned int src)
+{
+    unsigned char val = *hw_sim_reg(src);
+    hw_sim_sync(src);
+    return val;
+}
+
+unsigned short read_word(unsigned int src)
+{
+    unsigned short hi = read_byte(src);
+    return (hi << 8) | read_byte(src + 1);
+}
+
+unsigned int read_long(unsigned int src)
+{
+    unsigned int hi = read_word(src);
+    return (hi << 16) | read_word(src + 2);
+}
+
+void SYS_setVIntCallback(VoidCallback *CB)
+{
+    hw_sim_vint = CB;
+}
+
+u32 getSubTick(void)
+{
+    return hw_sim_subticks;
+}
+
+void SYS_doVBlankProcess(void)
+{
+    hw_sim_subticks += 1280;
+    if (hw_sim_vint)
+        hw_sim_vint();
+    if (hw_sim_sub)
+        hw_sim_sub();
+}
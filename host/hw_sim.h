@@ -0,0 +1,34 @@
+/*
+ * Host simulation of the Sega CD Gate Array as seen from the main CPU
+ */
+#ifndef _HW_SIM_H
+#define _HW_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// size of the simulated main CPU memory window starting at 0x400000:
+// BIOS ROM, Program RAM window and word RAM
+#define HW_SIM_MEM_BASE 0x400000
+#define HW_SIM_MEM_SIZE 0x240000
+
+// Gate Array registers 0xA12000-0xA1202F, indexed by (address - 0xA12000)
+extern volatile unsigned char hw_sim_ga[0x30];
+
+// hw_sim_reset clears the simulated registers and memory
+void hw_sim_reset(void);
+
+// hw_sim_set_sub_handler installs a function that plays the part of the Sub-CPU program,
+// it is called after every main CPU access to the Gate Array registers and on every VBlank
+// and is free to update the sub comm flag (0xA1200F) and status registers (0xA12020-0xA1202F)
+void hw_sim_set_sub_handler(void (*handler)(void));
+
+// hw_sim_access_count returns the number of main CPU accesses to the Gate Array registers
+unsigned int hw_sim_access_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HW_SIM_H
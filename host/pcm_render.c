@@ -0,0 +1,92 @@
+/*
+ * pcm_render - drives the scd_pcm.h API against the simulated driver and RF5C164
+ * for a couple of seconds and writes what the chip played to a WAV file
+ *
+ * Build: gcc -O2 -Ihost -Iinc -o pcm_render host/hw_sim.c host/rf5c164.c host/scd_drv_sim.c
+ *            src/scd_pcm.c src/hw_scd.c host/pcm_render.c
+ * Usage: pcm_render [output.wav]
+ *
+ * The printed checksum only depends on the command stream, so it can be kept as a
+ * golden value and compared after changes to scd_pcm.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hw_sim.h"
+#include "scd_drv_sim.h"
+#include "scd_pcm.h"
+
+#define SECONDS         2
+#define FRAME_SAMPLES   (RF5C164_RATE / 60 + 1)
+#define TONE_RATE       16000
+#define TONE_LEN        (TONE_RATE / 4)
+
+static u8 tone_wav[44 + TONE_LEN];
+static rf5c164_t chip;
+static s16 pcm[SECONDS * 60 * FRAME_SAMPLES * 2];
+
+static void wr32le(u8 *p, u32 v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+// a quarter second 8-bit mono triangle wave at 500Hz
+static void make_tone(void)
+{
+    u32 i, phase;
+
+    memcpy(tone_wav, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x01\0\0\0\0\0\0\0\0\0\x01\0\x08\0data", 40);
+    wr32le(tone_wav + 4, 36 + TONE_LEN);
+    wr32le(tone_wav + 24, TONE_RATE);
+    wr32le(tone_wav + 28, TONE_RATE);
+    wr32le(tone_wav + 40, TONE_LEN);
+
+    for (i = 0; i < TONE_LEN; i++) {
+        phase = (i * 500 * 256 / TONE_RATE) & 255;
+        tone_wav[44 + i] = phase < 128 ? 0x20 + phase * 3 / 2 : 0x20 + (255 - phase) * 3 / 2;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "pcm_render.wav";
+    scd_drv_sim_stats_t stats;
+    u32 frame, frames = 0, i;
+
+    make_tone();
+    hw_sim_reset();
+    scd_drv_sim_install(&chip);
+
+    scd_init_pcm();
+    scd_upload_buf(1, tone_wav, sizeof(tone_wav));
+
+    // one looping source panned left, one shot an octave up panned right
+    scd_src_play(1, 1, 0, 0, 255, 1);
+    scd_src_play(2, 1, TONE_RATE * 2, 254, 200, 0);
+
+    for (frame = 0; frame < SECONDS * 60; frame++) {
+        if (frame == 30)
+            scd_src_ramp(1, SCD_RAMP_PAN, 254, 76800); // sweep to the right over a second
+        if (frame == 80)
+            scd_src_ramp(1, SCD_RAMP_VOL|SCD_RAMP_STOP, 0, 76800 / 2);
+        scd_run_ramps();
+
+        SYS_doVBlankProcess();
+        scd_drv_sim_render(pcm + frames * 2, FRAME_SAMPLES);
+        frames += FRAME_SAMPLES;
+    }
+
+    if (!scd_drv_sim_write_wav(path, pcm, frames)) {
+        fprintf(stderr, "can't write %s\n", path);
+        return 1;
+    }
+
+    scd_drv_sim_get_stats(&stats);
+    printf("%s: %u samples, checksum %08x, %u commands\n", path, frames,
+        scd_drv_sim_checksum(pcm, frames), stats.cmds);
+    for (i = 0; i < 8; i++) {
+        if (stats.samples[i])
+            printf("source %u: %u samples streamed, %u from IMA ADPCM\n", i + 1, stats.samples[i], stats.ima_samples[i]);
+    }
+    printf("playback status at the end: %02x\n", scd_get_playback_status());
+    return 0;
+}
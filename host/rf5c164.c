@@ -0,0 +1,105 @@
+/*
+ * Software model of the Ricoh RF5C164 PCM chip of the Sega CD
+ */
+#include "rf5c164.h"
+
+void rf5c164_reset(rf5c164_t *chip)
+{
+    memset(chip, 0, sizeof(*chip));
+    chip->chan_off = 0xFF;
+}
+
+void rf5c164_write(rf5c164_t *chip, u8 reg, u8 val)
+{
+    rf5c164_channel_t *ch = chip->ch + chip->chan;
+
+    switch (reg) {
+        case RF5C164_ENV:
+            ch->env = val;
+            break;
+        case RF5C164_PAN:
+            ch->pan = val;
+            break;
+        case RF5C164_FDL:
+            ch->fd = (ch->fd & 0xFF00) | val;
+            break;
+        case RF5C164_FDH:
+            ch->fd = (ch->fd & 0x00FF) | (val << 8);
+            break;
+        case RF5C164_LSL:
+            ch->ls = (ch->ls & 0xFF00) | val;
+            break;
+        case RF5C164_LSH:
+            ch->ls = (ch->ls & 0x00FF) | (val << 8);
+            break;
+        case RF5C164_ST:
+            ch->st = val;
+            break;
+        case RF5C164_CTRL:
+            chip->sounding = val >> 7;
+            if (val & 0x40)
+                chip->chan = val & 7;
+            else
+                chip->bank = val & 15;
+            break;
+        case RF5C164_CHOFF:
+            // channels that were off start from their start address
+            for (reg = 0; reg < RF5C164_CHANNELS; reg++) {
+                if (chip->chan_off & (1 << reg))
+                    chip->ch[reg].addr = (u32)chip->ch[reg].st << 19;
+            }
+            chip->chan_off = val;
+            break;
+        default:
+            break;
+    }
+}
+
+void rf5c164_write_ram(rf5c164_t *chip, u16 ofs, u8 val)
+{
+    chip->ram[chip->bank * RF5C164_BANK_SIZE + (ofs & (RF5C164_BANK_SIZE - 1))] = val;
+}
+
+u16 rf5c164_read_addr(const rf5c164_t *chip, u8 chan)
+{
+    return chip->ch[chan & 7].addr >> 11;
+}
+
+void rf5c164_render(rf5c164_t *chip, s16 *out, u32 frames)
+{
+    u32 i, c;
+    s32 l, r, v;
+    u8 s;
+    rf5c164_channel_t *ch;
+
+    for (i = 0; i < frames; i++) {
+        l = r = 0;
+
+        for (c = 0, ch = chip->ch; c < RF5C164_CHANNELS; c++, ch++) {
+            if (chip->chan_off & (1 << c)) {
+                ch->addr = (u32)ch->st << 19; // held at the start address while off
+                continue;
+            }
+            if (!chip->sounding)
+                continue;
+
+            s = chip->ram[(ch->addr >> 11) & (RF5C164_RAM_SIZE - 1)];
+            if (s == RF5C164_LOOP_MARKER) {
+                ch->addr = (u32)ch->ls << 11;
+                s = chip->ram[ch->ls];
+                if (s == RF5C164_LOOP_MARKER)
+                    continue; // loop start on a marker, the channel is silent
+            }
+
+            v = (s & 0x80) ? (s & 0x7F) : -(s & 0x7F);
+            v = v * ch->env;
+            l += v * (ch->pan & 15) >> 5;
+            r += v * (ch->pan >> 4) >> 5;
+
+            ch->addr = (ch->addr + ch->fd) & 0x7FFFFFF;
+        }
+
+        out[i*2] = l > 32767 ? 32767 : (l < -32768 ? -32768 : l);
+        out[i*2 + 1] = r > 32767 ? 32767 : (r < -32768 ? -32768 : r);
+    }
+}
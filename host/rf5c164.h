@@ -0,0 +1,71 @@
+/*
+ * Software model of the Ricoh RF5C164 PCM chip of the Sega CD
+ */
+#ifndef _RF5C164_H
+#define _RF5C164_H
+
+#include <genesis.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RF5C164_CHANNELS    8
+#define RF5C164_RAM_SIZE    0x10000
+#define RF5C164_BANK_SIZE   0x1000  // wave RAM window seen by the Sub-CPU
+#define RF5C164_RATE        32552   // output sample rate, 12.5MHz / 384
+
+// registers, 0-6 are written to the channel selected through RF5C164_CTRL
+#define RF5C164_ENV     0
+#define RF5C164_PAN     1 // bits 0-3: left, bits 4-7: right
+#define RF5C164_FDL     2 // frequency delta, 0x0800 plays one sample per output sample
+#define RF5C164_FDH     3
+#define RF5C164_LSL     4 // loop start address
+#define RF5C164_LSH     5
+#define RF5C164_ST      6 // start address, high byte
+#define RF5C164_CTRL    7 // bit 7: sounding, bit 6 set: bits 0-2 select a channel, clear: bits 0-3 select a wave RAM bank
+#define RF5C164_CHOFF   8 // bit n set: channel n is off
+
+// wave RAM samples are sign-magnitude: bit 7 set for positive values, 0xFF is the loop marker
+#define RF5C164_LOOP_MARKER 0xFF
+
+typedef struct
+{
+    u8 env;
+    u8 pan;
+    u16 fd;
+    u16 ls;
+    u8 st;
+    u32 addr;       // 16.11 fixed point wave RAM address
+} rf5c164_channel_t;
+
+typedef struct
+{
+    rf5c164_channel_t ch[RF5C164_CHANNELS];
+    u8 ram[RF5C164_RAM_SIZE];
+    u8 sounding;
+    u8 chan;        // channel the registers 0-6 are written to
+    u8 bank;        // wave RAM bank mapped to the window
+    u8 chan_off;
+} rf5c164_t;
+
+// rf5c164_reset puts the chip in its power on state: not sounding, all channels off
+void rf5c164_reset(rf5c164_t *chip);
+
+// rf5c164_write writes one of the registers
+void rf5c164_write(rf5c164_t *chip, u8 reg, u8 val);
+
+// rf5c164_write_ram writes to wave RAM through the bank window selected with RF5C164_CTRL
+void rf5c164_write_ram(rf5c164_t *chip, u16 ofs, u8 val);
+
+// rf5c164_read_addr returns the current wave RAM address of a channel
+u16 rf5c164_read_addr(const rf5c164_t *chip, u8 chan);
+
+// rf5c164_render generates interleaved 16-bit stereo samples at RF5C164_RATE
+void rf5c164_render(rf5c164_t *chip, s16 *out, u32 frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RF5C164_H
@@ -0,0 +1,515 @@
+/*
+ * Host reimplementation of the PCM command handling of the Sub-CPU driver,
+ * playing through the RF5C164 model so that scd_pcm.h calls can be rendered to audio
+ *
+ * Each source streams its buffer into an 8KiB ring of wave RAM per hardware channel,
+ * closed by a loop marker, and the rings are refilled between render chunks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hw_md.h"
+#include "hw_sim.h"
+#include "scd_drv_sim.h"
+
+#define SIM_MAX_BUFS    256
+#define SIM_MAX_SRCS    8
+#define SIM_RING_SIZE   0x2000 // wave RAM per hardware channel
+#define SIM_RING_LEN    (SIM_RING_SIZE - 1) // samples in a ring, the last byte is the loop marker
+#define SIM_CHUNK       256 // output samples rendered between refills
+
+typedef struct
+{
+    u8 *data;       // unsigned 8-bit PCM, interleaved if stereo
+    u32 frames;
+    u16 freq;
+    u8 channels;
+    u8 ima;         // decoded from IMA ADPCM, the driver would decode it while playing
+} sim_buf_t;
+
+typedef struct
+{
+    u16 buf_id;     // 0 if the source is idle
+    u8 chans[2];
+    u8 num_chans;
+    u16 freq;
+    u8 pan;
+    u8 vol;
+    u8 autoloop;
+    u8 paused;
+    u32 pos;        // next buffer frame to stream
+    u32 written;    // samples written to the rings
+    u32 consumed;   // samples played by the chip
+    u32 end;        // written count at which the data ended, 0xFFFFFFFF while there's more
+    u16 last_rd;
+} sim_src_t;
+
+static rf5c164_t *sim_chip;
+static sim_buf_t sim_bufs[SIM_MAX_BUFS];
+static sim_src_t sim_srcs[SIM_MAX_SRCS];
+static u8 sim_chans_used;
+static scd_drv_sim_stats_t sim_stats;
+
+static const u16 sim_ima_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const s8 sim_ima_index[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static u16 sim_le16(const u8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static u32 sim_le32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static u32 sim_be32(const volatile u8 *p)
+{
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void sim_put_be32(volatile u8 *p, u32 v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static const u8 *sim_wav_chunk(const u8 *wav, u32 wav_len, const char *id, u32 *chunk_len)
+{
+    const u8 *p = wav + 12, *end = wav + wav_len;
+
+    if (wav_len < 12 || memcmp(wav, "RIFF", 4) || memcmp(wav + 8, "WAVE", 4))
+        return NULL;
+
+    while (p + 8 <= end) {
+        *chunk_len = sim_le32(p + 4);
+        if (!memcmp(p, id, 4))
+            return p + 8;
+        p += 8 + ((*chunk_len + 1) & ~1);
+    }
+    return NULL;
+}
+
+// decodes the first channel of IMA ADPCM blocks to unsigned 8-bit PCM
+static u32 sim_ima_decode(const u8 *in, u32 len, u16 block_align, u16 channels, u8 *out)
+{
+    u32 n = 0, b, i;
+    s32 pred, step, diff;
+    s16 index;
+    u8 nib;
+
+    for (b = 0; b + block_align <= len; b += block_align) {
+        pred = (s16)sim_le16(in + b);
+        index = in[b + 2] > 88 ? 88 : in[b + 2];
+        out[n++] = (pred + 0x8000) >> 8;
+
+        // 4 bytes of nibbles per channel, interleaved
+        for (i = 4 * channels; i < block_align; i++) {
+            if (((i - 4 * channels) / 4) % channels)
+                continue;
+            for (nib = 0; nib < 2; nib++) {
+                u8 code = nib ? in[b + i] >> 4 : in[b + i] & 15;
+                step = sim_ima_steps[index];
+                diff = step >> 3;
+                if (code & 1) diff += step >> 2;
+                if (code & 2) diff += step >> 1;
+                if (code & 4) diff += step;
+                pred += (code & 8) ? -diff : diff;
+                if (pred > 32767) pred = 32767;
+                else if (pred < -32768) pred = -32768;
+                index += sim_ima_index[code & 7];
+                if (index < 0) index = 0;
+                else if (index > 88) index = 88;
+                out[n++] = (pred + 0x8000) >> 8;
+            }
+        }
+    }
+    return n;
+}
+
+static void sim_load_buf(u16 buf_id, const u8 *data, u32 len)
+{
+    sim_buf_t *b;
+    const u8 *fmt, *pcm;
+    u32 fmt_len, pcm_len, i;
+    u16 codec, channels, bits;
+
+    if (buf_id < 1 || buf_id > SIM_MAX_BUFS)
+        return;
+
+    b = sim_bufs + buf_id - 1;
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+
+    fmt = sim_wav_chunk(data, len, "fmt ", &fmt_len);
+    pcm = sim_wav_chunk(data, len, "data", &pcm_len);
+    if (!fmt || !pcm || fmt_len < 16) {
+        // raw unsigned 8-bit mono
+        b->data = malloc(len ? len : 1);
+        memcpy(b->data, data, len);
+        b->frames = len;
+        b->freq = SCD_DRV_SIM_RAW_FREQ;
+        b->channels = 1;
+        return;
+    }
+
+    if (pcm + pcm_len > data + len)
+        pcm_len = data + len - pcm;
+    codec = sim_le16(fmt);
+    channels = sim_le16(fmt + 2) == 2 ? 2 : 1;
+    bits = sim_le16(fmt + 14);
+    b->freq = sim_le32(fmt + 4);
+
+    if (codec == 0x11) {
+        // the driver only plays mono IMA ADPCM, two nibbles per byte plus the header sample
+        b->data = malloc(pcm_len * 2 + 1);
+        b->frames = sim_ima_decode(pcm, pcm_len, sim_le16(fmt + 12), channels, b->data);
+        b->channels = 1;
+        b->ima = 1;
+    } else if (bits == 16) {
+        b->frames = pcm_len / (2 * channels);
+        b->data = malloc(b->frames * channels + 1);
+        for (i = 0; i < b->frames * channels; i++)
+            b->data[i] = (u8)((s8)pcm[i*2 + 1] + 128);
+        b->channels = channels;
+    } else {
+        b->frames = pcm_len / channels;
+        b->data = malloc(pcm_len + 1);
+        memcpy(b->data, pcm, pcm_len);
+        b->channels = channels;
+    }
+}
+
+// selects a channel and writes one of its registers
+static void sim_chan_write(u8 chan, u8 reg, u8 val)
+{
+    rf5c164_write(sim_chip, RF5C164_CTRL, 0xC0 | chan);
+    rf5c164_write(sim_chip, reg, val);
+}
+
+static void sim_ram_write(u32 addr, u8 val)
+{
+    rf5c164_write(sim_chip, RF5C164_CTRL, 0x80 | (addr / RF5C164_BANK_SIZE));
+    rf5c164_write_ram(sim_chip, addr, val);
+}
+
+// unsigned 8-bit PCM to sign-magnitude, keeping clear of the loop marker
+static u8 sim_sample(u8 s)
+{
+    if (s >= 128)
+        return 0x80 | (s - 128 > 0x7E ? 0x7E : s - 128);
+    return 128 - s > 0x7F ? 0x7F : 128 - s;
+}
+
+static void sim_src_apply(sim_src_t *s)
+{
+    sim_buf_t *b = sim_bufs + s->buf_id - 1;
+    u32 freq = s->freq ? s->freq : b->freq;
+    u16 fd = s->paused ? 0 : (freq << 11) / RF5C164_RATE;
+    u8 l = 15, r = 15, k;
+
+    if (s->pan != 255) {
+        // 0 is full left, 254 is full right
+        if (s->pan > 127)
+            l = (254 - s->pan) * 15 / 127;
+        if (s->pan < 127)
+            r = s->pan * 15 / 127;
+    }
+
+    for (k = 0; k < s->num_chans; k++) {
+        sim_chan_write(s->chans[k], RF5C164_ENV, s->paused ? 0 : s->vol);
+        if (s->num_chans == 2)
+            sim_chan_write(s->chans[k], RF5C164_PAN, k ? r << 4 : l);
+        else
+            sim_chan_write(s->chans[k], RF5C164_PAN, (r << 4) | l);
+        sim_chan_write(s->chans[k], RF5C164_FDL, fd);
+        sim_chan_write(s->chans[k], RF5C164_FDH, fd >> 8);
+    }
+}
+
+static void sim_src_fill(sim_src_t *s, u8 src_idx)
+{
+    sim_buf_t *b = sim_bufs + s->buf_id - 1;
+    u32 ofs;
+    u8 k;
+
+    while (s->written < s->consumed + SIM_RING_LEN - 1) {
+        ofs = s->written % SIM_RING_LEN;
+        for (k = 0; k < s->num_chans; k++)
+            sim_ram_write(s->chans[k] * SIM_RING_SIZE + ofs, s->pos < b->frames ? sim_sample(b->data[s->pos * b->channels + k]) : 0);
+
+        if (s->pos < b->frames) {
+            s->pos++;
+            sim_stats.samples[src_idx]++;
+            if (b->ima)
+                sim_stats.ima_samples[src_idx]++;
+            if (s->pos == b->frames) {
+                if (s->autoloop)
+                    s->pos = 0;
+                else
+                    s->end = s->written + 1;
+            }
+        }
+        s->written++;
+    }
+}
+
+static void sim_src_stop(sim_src_t *s)
+{
+    u8 k;
+
+    if (!s->buf_id)
+        return;
+    for (k = 0; k < s->num_chans; k++)
+        sim_chans_used &= ~(1 << s->chans[k]);
+    rf5c164_write(sim_chip, RF5C164_CHOFF, ~sim_chans_used);
+    s->buf_id = 0;
+}
+
+static u8 sim_src_start(u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    sim_src_t *s;
+    sim_buf_t *b;
+    u8 i, k, c;
+
+    if (buf_id < 1 || buf_id > SIM_MAX_BUFS || !sim_bufs[buf_id - 1].data)
+        return 0;
+    b = sim_bufs + buf_id - 1;
+
+    if (src_id == 255) {
+        for (src_id = 0, i = 0; i < SIM_MAX_SRCS; i++) {
+            if (!sim_srcs[i].buf_id) {
+                src_id = i + 1;
+                break;
+            }
+        }
+    }
+    if (src_id < 1 || src_id > SIM_MAX_SRCS)
+        return 0;
+
+    s = sim_srcs + src_id - 1;
+    sim_src_stop(s);
+
+    for (k = 0, c = 0; k < b->channels && c < RF5C164_CHANNELS; c++) {
+        if (!(sim_chans_used & (1 << c)))
+            s->chans[k++] = c;
+    }
+    if (k < b->channels)
+        return 0; // not enough free hardware channels
+
+    s->buf_id = buf_id;
+    s->num_chans = b->channels;
+    s->freq = freq;
+    s->pan = pan;
+    s->vol = vol;
+    s->autoloop = autoloop;
+    s->paused = 0;
+    s->pos = 0;
+    s->written = 0;
+    s->consumed = 0;
+    s->end = 0xFFFFFFFF;
+    s->last_rd = 0;
+
+    for (k = 0; k < s->num_chans; k++) {
+        c = s->chans[k];
+        sim_chans_used |= 1 << c;
+        sim_ram_write(c * SIM_RING_SIZE + SIM_RING_LEN, RF5C164_LOOP_MARKER);
+        sim_chan_write(c, RF5C164_ST, (c * SIM_RING_SIZE) >> 8);
+        sim_chan_write(c, RF5C164_LSL, 0);
+        sim_chan_write(c, RF5C164_LSH, (c * SIM_RING_SIZE) >> 8);
+    }
+    sim_src_apply(s);
+    sim_src_fill(s, src_id - 1);
+    rf5c164_write(sim_chip, RF5C164_CHOFF, ~sim_chans_used);
+    return src_id;
+}
+
+// tracks how far the chip has played each source, ends finished sources and refills the rings
+static void sim_update_sources(void)
+{
+    sim_src_t *s;
+    u16 rd;
+    u8 i, mask = 0;
+
+    for (i = 0, s = sim_srcs; i < SIM_MAX_SRCS; i++, s++) {
+        if (!s->buf_id)
+            continue;
+
+        rd = rf5c164_read_addr(sim_chip, s->chans[0]) - s->chans[0] * SIM_RING_SIZE;
+        if (rd >= SIM_RING_LEN)
+            rd = 0; // on the loop marker
+        s->consumed += (rd + SIM_RING_LEN - s->last_rd) % SIM_RING_LEN;
+        s->last_rd = rd;
+
+        if (s->consumed >= s->end) {
+            sim_src_stop(s);
+            continue;
+        }
+        sim_src_fill(s, i);
+        mask |= 1 << i;
+    }
+
+    hw_sim_ga[0x2F] = mask;
+}
+
+static void sim_handler(void)
+{
+    u8 cmd = hw_sim_ga[0x0E], src_id;
+    u32 a0, a1, a2, res0 = 0, res1 = 0;
+    sim_src_t *s;
+    u16 i;
+
+    if (!cmd) {
+        hw_sim_ga[0x0F] = 0;
+        return;
+    }
+    if (hw_sim_ga[0x0F])
+        return; // already acknowledged, waiting for the main CPU to clear the command
+
+    a0 = sim_be32(hw_sim_ga + 0x10);
+    a1 = sim_be32(hw_sim_ga + 0x14);
+    a2 = sim_be32(hw_sim_ga + 0x18);
+    src_id = (a0 >> 16) & 0xff;
+    s = src_id >= 1 && src_id <= SIM_MAX_SRCS ? sim_srcs + src_id - 1 : NULL;
+
+    switch (cmd) {
+        case 'I':
+            for (i = 0; i < SIM_MAX_SRCS; i++)
+                sim_src_stop(sim_srcs + i);
+            for (i = 0; i < SIM_MAX_BUFS; i++) {
+                free(sim_bufs[i].data);
+                sim_bufs[i].data = NULL;
+            }
+            break;
+        case 'B':
+            sim_load_buf(a0 >> 16, hw_sim_mem(0x600000 + (a1 - 0x0C0000)), a2);
+            break;
+        case 'A':
+            res0 = (u32)sim_src_start(src_id, a0 & 0xffff, a1 >> 16, a1 & 0xff, (a2 >> 16) & 0xff, a2 & 0xff) << 24;
+            break;
+        case 'U':
+            if (s && s->buf_id) {
+                s->freq = a1 >> 16;
+                s->pan = a1 & 0xff;
+                s->vol = (a2 >> 16) & 0xff;
+                s->autoloop = a2 & 0xff;
+                sim_src_apply(s);
+            }
+            break;
+        case 'N':
+            if (s && s->buf_id) {
+                s->paused = a0 & 0xff;
+                sim_src_apply(s);
+            }
+            res0 = a0 & 0xff;
+            break;
+        case 'W':
+            if (s && s->buf_id)
+                sim_src_start(src_id, s->buf_id, s->freq, s->pan, s->vol, s->autoloop);
+            break;
+        case 'O':
+            if (s)
+                sim_src_stop(s);
+            break;
+        case 'G':
+            if (s && s->buf_id)
+                res0 = (u32)rf5c164_read_addr(sim_chip, s->chans[0]) << 16;
+            break;
+        case 'L':
+            for (i = 0; i < SIM_MAX_SRCS; i++)
+                sim_src_stop(sim_srcs + i);
+            break;
+        case 'D':
+            res0 = 0x1000 << 16; // no disc
+            break;
+        default:
+            break; // 'E' suspends mixing on the driver, commands are applied between render chunks here
+    }
+
+    sim_put_be32(hw_sim_ga + 0x20, res0);
+    sim_put_be32(hw_sim_ga + 0x24, res1);
+    sim_stats.cmds++;
+    sim_update_sources();
+    hw_sim_ga[0x0F] = cmd;
+}
+
+void scd_drv_sim_install(rf5c164_t *chip)
+{
+    u16 i;
+
+    for (i = 0; i < SIM_MAX_BUFS; i++)
+        free(sim_bufs[i].data);
+    memset(sim_bufs, 0, sizeof(sim_bufs));
+    memset(sim_srcs, 0, sizeof(sim_srcs));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    sim_chans_used = 0;
+
+    sim_chip = chip;
+    rf5c164_reset(chip);
+    rf5c164_write(chip, RF5C164_CTRL, 0x80);
+    hw_sim_set_sub_handler(sim_handler);
+}
+
+void scd_drv_sim_render(s16 *out, u32 frames)
+{
+    u32 n;
+
+    while (frames) {
+        n = frames < SIM_CHUNK ? frames : SIM_CHUNK;
+        sim_update_sources();
+        rf5c164_render(sim_chip, out, n);
+        out += n * 2;
+        frames -= n;
+    }
+    sim_update_sources();
+}
+
+void scd_drv_sim_get_stats(scd_drv_sim_stats_t *stats)
+{
+    *stats = sim_stats;
+}
+
+u32 scd_drv_sim_checksum(const s16 *pcm, u32 frames)
+{
+    u32 h = 2166136261u, i;
+
+    for (i = 0; i < frames * 2; i++) {
+        h = (h ^ (pcm[i] & 0xff)) * 16777619u;
+        h = (h ^ ((pcm[i] >> 8) & 0xff)) * 16777619u;
+    }
+    return h;
+}
+
+int scd_drv_sim_write_wav(const char *path, const s16 *pcm, u32 frames)
+{
+    u8 hdr[44];
+    u32 i, len = frames * 4;
+    FILE *f = fopen(path, "wb");
+
+    if (!f)
+        return 0;
+
+    memcpy(hdr, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x02\0\0\0\0\0\0\0\0\0\x04\0\x10\0data", 40);
+    for (i = 0; i < 4; i++) {
+        hdr[4 + i] = (36 + len) >> (i*8);
+        hdr[24 + i] = RF5C164_RATE >> (i*8);
+        hdr[28 + i] = (RF5C164_RATE * 4) >> (i*8);
+        hdr[40 + i] = len >> (i*8);
+    }
+    fwrite(hdr, 1, sizeof(hdr), f);
+
+    for (i = 0; i < frames * 2; i++) {
+        fputc(pcm[i] & 0xff, f);
+        fputc((pcm[i] >> 8) & 0xff, f);
+    }
+    return fclose(f) == 0;
+}
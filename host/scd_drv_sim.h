@@ -0,0 +1,49 @@
+/*
+ * Host reimplementation of the PCM command handling of the Sub-CPU driver,
+ * playing through the RF5C164 model so that scd_pcm.h calls can be rendered to audio
+ */
+#ifndef _SCD_DRV_SIM_H
+#define _SCD_DRV_SIM_H
+
+#include <genesis.h>
+#include "rf5c164.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// frequency for raw sample data played with freq 0, raw data carries no rate
+#define SCD_DRV_SIM_RAW_FREQ 16000
+
+typedef struct
+{
+    u32 cmds;           // commands handled
+    u32 samples[8];     // samples streamed to the chip per source
+    u32 ima_samples[8]; // of those, samples that the driver would have decoded from IMA ADPCM
+} scd_drv_sim_stats_t;
+
+// scd_drv_sim_install resets the chip model and the simulated driver and installs the
+// command handler with hw_sim_set_sub_handler
+// handled commands: 'I', 'A', 'U', 'O', 'N', 'W', 'G', 'L', 'E' and 'B', the CD commands are
+// acknowledged with empty results as if there was no disc
+void scd_drv_sim_install(rf5c164_t *chip);
+
+// scd_drv_sim_render streams the playing sources to wave RAM and renders interleaved
+// 16-bit stereo samples at RF5C164_RATE, about 543 per 60Hz frame
+void scd_drv_sim_render(s16 *out, u32 frames);
+
+// scd_drv_sim_get_stats returns the counters since scd_drv_sim_install
+void scd_drv_sim_get_stats(scd_drv_sim_stats_t *stats);
+
+// scd_drv_sim_checksum returns a 32-bit FNV-1a hash of rendered samples for golden output comparisons
+u32 scd_drv_sim_checksum(const s16 *pcm, u32 frames);
+
+// scd_drv_sim_write_wav writes rendered samples to a 16-bit stereo WAV file
+// returned value: 1 on success
+int scd_drv_sim_write_wav(const char *path, const s16 *pcm, u32 frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SCD_DRV_SIM_H
@@ -0,0 +1,175 @@
+/*
+ * steal_test - replays a burst of 100 scd_src_play_steal calls for every voice stealing
+ * policy against the simulated driver and checks which voices survive
+ *
+ * Build: gcc -O2 -Ihost -Iinc -o steal_test host/hw_sim.c host/rf5c164.c host/scd_drv_sim.c
+ *            src/scd_pcm.c src/hw_scd.c host/steal_test.c
+ * Usage: steal_test
+ *
+ * Every play gets a volume of its own, so the surviving voices can be told apart both in
+ * the source state kept by the main CPU and in the envelope registers of the chip model.
+ * The expected survivors come from a plain model of the policies below; the exit status
+ * is 0 if all policies match it
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hw_sim.h"
+#include "scd_drv_sim.h"
+#include "scd_pcm.h"
+
+#define NUM_PLAYS       100
+#define NUM_PROTECTED   3 // sources given a high priority for SCD_STEAL_PRIORITY
+
+typedef struct
+{
+    u8 vol;         // 0 if the model source is free
+    u8 priority;
+    u16 play;       // index of the play that started it
+} model_src_t;
+
+static u8 tone_wav[44 + 1000];
+static rf5c164_t chip;
+static s16 pcm[RF5C164_RATE / 60 * 2];
+
+static const char *policy_names[] = { "none", "oldest", "quietest", "priority" };
+
+static u8 play_vol(u16 play)
+{
+    return 1 + play * 53 % 250; // distinct for every play of the burst
+}
+
+// the source the policy steals, ties go to the oldest, 0 if none qualifies
+static u8 model_victim(const model_src_t *srcs, u8 policy)
+{
+    u8 i, victim = 0;
+    const model_src_t *best = NULL;
+
+    if (policy == SCD_STEAL_NONE)
+        return 0;
+    for (i = 0; i < SCD_MAX_SRCS; i++) {
+        const model_src_t *s = srcs + i;
+        if (policy == SCD_STEAL_PRIORITY && s->priority > SCD_PRIORITY_DEFAULT)
+            continue;
+        if (best) {
+            u8 better;
+            if (policy == SCD_STEAL_QUIETEST && s->vol != best->vol)
+                better = s->vol < best->vol;
+            else if (policy == SCD_STEAL_PRIORITY && s->priority != best->priority)
+                better = s->priority < best->priority;
+            else
+                better = s->play < best->play;
+            if (!better)
+                continue;
+        }
+        best = s;
+        victim = i + 1;
+    }
+    return victim;
+}
+
+static int cmp_u8(const void *a, const void *b)
+{
+    return *(const u8 *)a - *(const u8 *)b;
+}
+
+static int run_policy(u8 policy)
+{
+    model_src_t model[SCD_MAX_SRCS];
+    scd_src_info_t state[SCD_MAX_SRCS];
+    u8 expect[SCD_MAX_SRCS], got_main[SCD_MAX_SRCS], got_chip[SCD_MAX_SRCS];
+    u8 i, src_id, stolen, exp_src, exp_stolen;
+    u16 play;
+    int errors = 0;
+
+    hw_sim_reset();
+    scd_drv_sim_install(&chip);
+    scd_init_pcm();
+    scd_upload_buf(1, tone_wav, sizeof(tone_wav));
+    memset(model, 0, sizeof(model));
+    for (i = 0; i < SCD_MAX_SRCS; i++)
+        model[i].priority = SCD_PRIORITY_DEFAULT; // priorities belong to source ids, not plays
+
+    for (play = 0; play < NUM_PLAYS; play++) {
+        if (play == SCD_MAX_SRCS && policy == SCD_STEAL_PRIORITY) {
+            for (i = 0; i < NUM_PROTECTED; i++) {
+                scd_src_set_priority(i + 1, SCD_PRIORITY_DEFAULT + 1);
+                model[i].priority = SCD_PRIORITY_DEFAULT + 1;
+            }
+        }
+
+        // the expected outcome: a free source first, then the policy's victim
+        exp_stolen = 0;
+        for (exp_src = 0, i = 0; i < SCD_MAX_SRCS; i++) {
+            if (!model[i].vol) {
+                exp_src = i + 1;
+                break;
+            }
+        }
+        if (!exp_src)
+            exp_src = exp_stolen = model_victim(model, policy);
+        if (exp_src) {
+            model[exp_src - 1].vol = play_vol(play);
+            model[exp_src - 1].play = play;
+        }
+
+        src_id = scd_src_play_steal(1, 0, 255, play_vol(play), 1, policy, &stolen);
+        if (src_id != exp_src || stolen != exp_stolen) {
+            printf("%s: play %u started on %u stealing %u, expected %u stealing %u\n",
+                policy_names[policy], play, src_id, stolen, exp_src, exp_stolen);
+            errors++;
+        }
+
+        // one play per frame, so every source has a start time of its own
+        SYS_doVBlankProcess();
+        scd_drv_sim_render(pcm, RF5C164_RATE / 60);
+    }
+
+    // survivors by volume: the model, the main CPU source state and the chip
+    for (i = 0; i < SCD_MAX_SRCS; i++)
+        expect[i] = model[i].vol;
+    scd_src_get_state_all(state);
+    for (i = 0; i < SCD_MAX_SRCS; i++)
+        got_main[i] = (state[i].flags & SCD_SRC_PLAYING) ? state[i].vol : 0;
+    for (i = 0; i < SCD_MAX_SRCS; i++)
+        got_chip[i] = (chip.chan_off & (1 << i)) ? 0 : chip.ch[i].env;
+    qsort(expect, SCD_MAX_SRCS, 1, cmp_u8);
+    qsort(got_main, SCD_MAX_SRCS, 1, cmp_u8);
+    qsort(got_chip, SCD_MAX_SRCS, 1, cmp_u8);
+
+    if (memcmp(expect, got_main, SCD_MAX_SRCS) || memcmp(expect, got_chip, SCD_MAX_SRCS)) {
+        printf("%s: surviving volumes differ\n  expected:", policy_names[policy]);
+        for (i = 0; i < SCD_MAX_SRCS; i++)
+            printf(" %u", expect[i]);
+        printf("\n  main:    ");
+        for (i = 0; i < SCD_MAX_SRCS; i++)
+            printf(" %u", got_main[i]);
+        printf("\n  chip:    ");
+        for (i = 0; i < SCD_MAX_SRCS; i++)
+            printf(" %u", got_chip[i]);
+        printf("\n");
+        errors++;
+    }
+
+    printf("%s: %s\n", policy_names[policy], errors ? "FAIL" : "ok");
+    return errors;
+}
+
+int main(void)
+{
+    u32 i;
+    u8 policy;
+    int errors = 0;
+
+    // a looping 8-bit mono sample, so no voice ends on its own during the burst
+    memcpy(tone_wav, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x01\0\x80\x3e\0\0\x80\x3e\0\0\x01\0\x08\0data", 40);
+    tone_wav[4] = (36 + 1000) & 0xff;
+    tone_wav[5] = (36 + 1000) >> 8;
+    tone_wav[40] = 1000 & 0xff;
+    tone_wav[41] = 1000 >> 8;
+    for (i = 0; i < 1000; i++)
+        tone_wav[44 + i] = i & 16 ? 0xA0 : 0x60;
+
+    for (policy = SCD_STEAL_NONE; policy <= SCD_STEAL_PRIORITY; policy++)
+        errors += run_policy(policy);
+    return errors ? 1 : 0;
+}
@@ -5,6 +5,49 @@
 extern "C" {
 #endif
 
+#if defined(__m68k__)
+
+// MD_MEM turns a main CPU bus address (BIOS, Program RAM window, word RAM) into a pointer
+#define MD_MEM(addr) ((void *)(addr))
+
+static inline void write_byte(unsigned int dst, unsigned char val)
+{
+    *(volatile unsigned char *)dst = val;
+}
+
+static inline void write_word(unsigned int dst, unsigned short val)
+{
+    *(volatile unsigned short *)dst = val;
+}
+
+static inline void write_long(unsigned int dst, unsigned int val)
+{
+    *(volatile unsigned int *)dst = val;
+}
+
+static inline unsigned char read_byte(unsigned int src)
+{
+    return *(volatile unsigned char *)src;
+}
+
+static inline unsigned short read_word(unsigned int src)
+{
+    return *(volatile unsigned short *)src;
+}
+
+static inline unsigned int read_long(unsigned int src)
+{
+    return *(volatile unsigned int *)src;
+}
+
+#else
+
+// host build: the Gate Array registers at 0xA12000-0xA1202F and the memory at
+// 0x400000-0x63FFFF are simulated in-process by host/hw_sim.c
+extern void *hw_sim_mem(unsigned int addr);
+
+#define MD_MEM(addr) hw_sim_mem(addr)
+
 extern void write_byte(unsigned int dst, unsigned char val);
 extern void write_word(unsigned int dst, unsigned short val);
 extern void write_long(unsigned int dst, unsigned int val);
@@ -12,6 +55,8 @@ extern unsigned char read_byte(unsigned int src);
 extern unsigned short read_word(unsigned int src);
 extern unsigned int read_long(unsigned int src);
 
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,8 @@
 
 void *memset2(void *ptr, int value, u32 num);
 
+void *custom_memcpy(void *dest, const void *src, u32 n);
+
 void secondInt();
 
 u16 InitCd(void);
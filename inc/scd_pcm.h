@@ -6,6 +6,142 @@
 #define SCD_CODE_ATTR
 #endif
 
+// number of submitted commands that can be in flight at once, must be a power of two
+#define SCD_MAX_ASYNC_CMDS 8
+
+// a ticket identifies a submitted command until SCD_MAX_ASYNC_CMDS more commands are submitted
+typedef u16 scd_ticket_t;
+
+// number of sources, src_id values are [1, SCD_MAX_SRCS]
+#define SCD_MAX_SRCS 8
+
+// priority of a source until scd_src_set_priority is called
+#define SCD_PRIORITY_DEFAULT 128
+
+// number of IMA ADPCM sources the Sub-CPU can decode without degradation
+#define SCD_DEFAULT_ADPCM_BUDGET 7
+
+// voice stealing policies for scd_src_play_steal
+#define SCD_STEAL_NONE      0 // behave like scd_src_play with src_id 255
+#define SCD_STEAL_OLDEST    1 // the source started longest ago
+#define SCD_STEAL_QUIETEST  2 // the source with the lowest volume
+#define SCD_STEAL_PRIORITY  3 // the lowest priority source at or below SCD_PRIORITY_DEFAULT
+
+// number of tracks that can be queued with scd_spcm_queue_track
+#define SCD_SPCM_PLAYLIST_SIZE 8
+
+// number of commands that can wait in the schedule, see scd_schedule_play_src
+#define SCD_MAX_SCHED_CMDS 16
+
+// size of the word RAM bank visible to the main CPU in 1M mode
+#define SCD_WORD_RAM_SIZE 0x20000
+
+// number of sample buffers, buf_id values are [1, SCD_MAX_BUFS]
+#define SCD_MAX_BUFS 256
+
+// loop_end for scd_buf_set_loop: take the loop stored with the sample, the smpl chunk of a WAV file
+// or the loop start in the header of a native sample
+#define SCD_LOOP_SMPL 0xFFFFFFFF
+
+// approximate size of the driver memory pool for sample buffers
+#define SCD_SAMPLE_POOL_SIZE (460*1024)
+
+// native sample files produced by tools/wav2scd start with this header,
+// multi-byte fields are big-endian
+#define SCD_NATIVE_HDR_SIZE 16
+#define SCD_NO_LOOP 0xFFFFFFFF
+
+// native sample codecs
+#define SCD_CODEC_PCM_U8 0
+#define SCD_CODEC_DPCM4  1 // 4-bit DPCM, decoded to 8-bit PCM by the main CPU on upload
+
+typedef struct
+{
+    char magic[4];      // "SCDN"
+    u32 data_len;       // bytes of sample data following the header, two samples per byte for DPCM
+    u16 freq;           // playback frequency, used by scd_src_play and scd_src_update when freq is 0
+    u8 codec;           // SCD_CODEC_PCM_U8 or SCD_CODEC_DPCM4
+    u8 channels;        // always 1
+    u32 loop_start;     // loop start in samples, the loop ends with the sample, or SCD_NO_LOOP
+} scd_native_hdr_t;
+
+typedef struct
+{
+    u32 pool_size;      // size of the driver sample pool
+    u32 pool_free;      // bytes never allocated from the pool
+    u32 used;           // bytes in buffers that haven't been freed
+    u32 freed;          // bytes in freed buffers, reusable by scd_alloc_buf
+    u32 largest_freed;  // largest freed buffer
+    u32 largest_free;   // largest sample scd_alloc_buf can currently place
+    u16 num_used;       // number of buffers in use
+    u16 fragmentation;  // percentage of free memory that is not part of the largest free block
+} scd_mem_info_t;
+
+typedef struct
+{
+    u32 cmds;           // commands completed since the last scd_reset_stats
+    u32 latency_last;   // submission to acknowledge time of the last command, in subticks (1/76800s)
+    u32 latency_max;    // longest submission to acknowledge time
+    u32 latency_avg;    // average submission to acknowledge time
+    u32 cmds_avoided;   // redundant updates and coalesced queue commands that were never sent
+    u16 pending;        // commands submitted but not acknowledged yet
+    u8 playing;         // scd_get_playback_status mask
+    u8 spcm_playing;    // scd_spcm_get_playback_status mask
+    scd_mem_info_t mem; // scd_get_mem_info
+} scd_stats_t;
+
+// maximum number of tracks on a disc
+#define SCD_MAX_TRACKS 99
+
+typedef struct
+{
+    u32 start;          // MMSSFFTN minutes|seconds|frames|track number, minutes to frames in BCD
+    u32 length;         // track length in frames (1/75s), 0 for the last track
+    u8 type;            // track type - DATA (non-zero) or CDDA (0)
+} scd_cdda_track_t;
+
+// number of tracks that can be queued with scd_cdda_queue_track
+#define SCD_CDDA_SEQUENCE_SIZE 8
+
+// full cdda volume
+#define SCD_CDDA_MAX_VOLUME 1024
+
+typedef struct
+{
+    u32 rel;            // frames (1/75s) since the start of the track
+    u32 abs;            // frames since the start of the disc, 0 if the track table isn't cached
+    u16 track;          // track being played, 0 if stopped
+} scd_cdda_timecode_t;
+
+// a point of an envelope: the value is reached after duration subticks (1/76800s)
+typedef struct
+{
+    u16 value;
+    u32 duration;
+} scd_env_point_t;
+
+// parameters for scd_src_ramp and scd_src_set_envelope
+#define SCD_RAMP_VOL    0
+#define SCD_RAMP_PAN    1
+#define SCD_RAMP_FREQ   2
+#define SCD_RAMP_STOP   0x80 // or'ed with the parameter: stop the source once the ramp is done
+
+#define SCD_ENV_NO_SUSTAIN 0xff
+
+#define SCD_SRC_PLAYING 1 // the source has its bit set in the playback status mask
+#define SCD_SRC_PAUSED  2
+#define SCD_SRC_LOOPING 4
+
+typedef struct
+{
+    u16 buf_id;         // buffer last started on the source, 0 if stopped or never started
+    u16 pos;            // position returned by the last completed scd_src_get_pos(_async) call
+    u32 pos_time;       // subtick count when pos was read, 0 if it hasn't been read since playback started
+    u8 flags;           // SCD_SRC_PLAYING, SCD_SRC_PAUSED and SCD_SRC_LOOPING
+    u8 vol;
+    u8 priority;
+} scd_src_info_t;
+
 /* Initialize Function */
 // scd_init_pcm initializes the PCM driver
 void scd_init_pcm(void);
@@ -20,6 +156,36 @@ void scd_spcm_stop_track() SCD_CODE_ATTR;
 // scd_spcm_resume_track resumes spcm playback
 void scd_spcm_resume_track(void) SCD_CODE_ATTR;
 
+// scd_spcm_queue_track adds a track to the playlist, which is started by scd_run_spcm once the
+// current track ends, a track queued when nothing is playing starts right away
+// the name is copied and must be shorter than 16 characters
+// a track played with repeat set never ends, use scd_spcm_next_track to move on
+// scd_spcm_play_track and scd_spcm_stop_track clear the playlist
+//
+// returned value: 1 if the track has been queued, 0 if the playlist is full
+u8 scd_spcm_queue_track(const char *name, int repeat) SCD_CODE_ATTR;
+
+// scd_spcm_next_track starts the next track of the playlist right away
+// returned value: 0 if the playlist is empty
+u8 scd_spcm_next_track(void) SCD_CODE_ATTR;
+
+// scd_run_spcm starts the next track of the playlist when the current one has ended,
+// call it once per frame while a playlist is playing
+// returned value: the same as scd_spcm_get_playlist_index
+int scd_run_spcm(void) SCD_CODE_ATTR;
+
+// scd_spcm_get_playlist_index returns the number of tracks started since scd_spcm_play_track,
+// 0 for the track passed to it, or -1 if spcm playback has been stopped,
+// scd_spcm_resume_track brings back the index of the stopped track
+int scd_spcm_get_playlist_index(void) SCD_CODE_ATTR;
+
+// scd_spcm_get_time returns how long the current spcm track has been playing in subticks (1/76800s),
+// measured on the main CPU without a handshake from the start of the track, not counting the time
+// it was stopped for, the clock runs from when scd_run_spcm first sees the track playing, so the
+// file is opened and the stream refilled on its own time, and stops when scd_run_spcm sees it end
+// scd_spcm_resume_track continues the track from where scd_spcm_stop_track stopped it
+u32 scd_spcm_get_time(void) SCD_CODE_ATTR;
+
 // scd_spcm_get_playback_status returns playback status mask for spcm
 // if a source is active, it will have its bit set to 1 in the mask:
 // bit 0 for source id 1, bit 1 for source id 2, etc
@@ -30,11 +196,56 @@ int scd_spcm_get_playback_status(void) SCD_CODE_ATTR;
 long long int scd_get_disc_info(void);
 
 // scd_cdda_get_track_info 
+// the information comes from the table filled in by scd_cdda_get_toc, later calls for a disc
+// only make the two requests that check it hasn't been swapped
 long long int scd_cdda_get_track_info(u16 track) SCD_CODE_ATTR;
 
+// scd_cdda_get_toc returns the track table of the disc, indexed by track number - 1,
+// the table is read with one request per track the first time it's needed and
+// kept until scd_get_disc_info reports that there's no disc or the tray is open,
+// scd_cdda_get_track_info and every track start check that the disc hasn't been swapped
+// first and last are set to the first and last track numbers, 0 if there's no disc,
+// either can be NULL
+const scd_cdda_track_t *scd_cdda_get_toc(u8 *first, u8 *last) SCD_CODE_ATTR;
+
+// scd_cdda_invalidate_toc forgets the track table, the next lookup reads it again
+void scd_cdda_invalidate_toc(void) SCD_CODE_ATTR;
+
 // scd_cdda_set_volume
+// value range for volume: [0, SCD_CDDA_MAX_VOLUME]
 void scd_cdda_set_volume(u16 volume) SCD_CODE_ATTR;
 
+// scd_cdda_fade moves the cdda volume to the given value over duration subticks (1/76800s),
+// if stop is set, playback is stopped at the end of the fade and the volume goes back to
+// what it was when the fade started, ready for the next track
+// the fade is stepped by scd_run_cdda, which sends a volume command only when the volume changes
+void scd_cdda_fade(u16 volume, u32 duration, u8 stop) SCD_CODE_ATTR;
+
+// scd_cdda_queue_track adds a track to the cdda sequence, which is started by scd_run_cdda once
+// the drive has stopped at the end of the current track, a track queued when nothing is playing
+// starts right away
+// a track played with repeat set never ends, use scd_cdda_next_track to move on
+// scd_cdda_play_track and scd_cdda_stop_track clear the sequence
+//
+// returned value: 1 if the track has been queued, 0 if the sequence is full
+u8 scd_cdda_queue_track(u16 track, u16 repeat) SCD_CODE_ATTR;
+
+// scd_cdda_next_track starts the next track of the sequence right away
+// returned value: 0 if the sequence is empty
+u8 scd_cdda_next_track(void) SCD_CODE_ATTR;
+
+// scd_run_cdda advances the cdda fade and the sequence, call it once per frame while fading
+// or while a sequence is playing, the drive status is only read once the current track
+// should have ended
+// returned value: non-zero while the fade is in progress
+int scd_run_cdda(void) SCD_CODE_ATTR;
+
+// scd_cdda_get_timecode fills in the playback position of the track started with scd_cdda_play_track,
+// counted on the main CPU from the moment the drive accepted the play command, so the seek to the
+// track makes it run slightly ahead, no handshake is needed
+// the absolute time is only known once the track table has been read with scd_cdda_get_toc
+void scd_cdda_get_timecode(scd_cdda_timecode_t *tc) SCD_CODE_ATTR;
+
 // scd_cdda_play_track starts a cdda track
 void scd_cdda_play_track(u16 track, u16 repeat) SCD_CODE_ATTR;
 
@@ -88,8 +299,41 @@ void scd_src_rewind(u8 src_id) SCD_CODE_ATTR;
 // values for vol: [0, 255]
 // values for autoloop: [0, 255], a boolean: the source will automatically loopf from the start after
 // reaching the end of the playback buffer
+//
+// an update that matches the values last sent to the source with scd_src_play or
+// scd_src_update isn't sent to the driver, see cmds_avoided in scd_stats_t
 void scd_src_update(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
 
+// scd_src_get_state_all fills in SCD_MAX_SRCS entries, one for each source id starting with 1,
+// from the playback status mask and the commands acknowledged so far, without a handshake
+// positions are only as recent as pos_time, a scd_src_get_pos_async call that isn't waited
+// on refreshes pos once the driver has answered
+void scd_src_get_state_all(scd_src_info_t *state) SCD_CODE_ATTR;
+
+// scd_src_set_priority sets the priority of a source, higher values are more important
+// when a new IMA ADPCM sample would exceed the ADPCM budget, the lowest priority IMA ADPCM
+// source with a lower priority than the new one is stopped to make room, if there's
+// none the new sample isn't started and scd_src_play returns 0
+// samples played on src_id 255 have SCD_PRIORITY_DEFAULT, which the source they start on keeps
+//
+// value range for src_id: [1, 8]
+void scd_src_set_priority(u8 src_id, u8 priority) SCD_CODE_ATTR;
+
+// scd_src_play_steal starts playback on a free source like scd_src_play with src_id 255,
+// but when all sources are busy one of them is stopped and reused according to policy,
+// ties are broken by the oldest source
+//
+// the stolen source id is written to stolen_src, 0 if a free source was used or nothing
+// was stolen, stolen_src can be NULL
+// returned value: the source id, 0 if playback couldn't be started
+u8 scd_src_play_steal(u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop, u8 policy, u8 *stolen_src) SCD_CODE_ATTR;
+
+// scd_set_adpcm_budget sets the number of IMA ADPCM sources that may play at once,
+// SCD_DEFAULT_ADPCM_BUDGET by default, samples uploaded from ROM with scd_upload_buf are
+// recognized as IMA ADPCM, samples loaded from CD are counted once marked with scd_buf_set_ima
+// plays still waiting to be issued count against the budget, sources with a stop waiting don't
+void scd_set_adpcm_budget(u8 max_srcs) SCD_CODE_ATTR;
+
 // scd_src_get_pos returns playback position for the given source
 //
 // value range for src_id: [1, 8]
@@ -99,26 +343,113 @@ u16 scd_src_get_pos(u8 src_id) SCD_CODE_ATTR;
 
 /* Other Functions */
 // scd_open_file opens file on CD
+// results are cached, so opening the same file again doesn't search the disc, a cached
+// result is only used after a two request check that the disc hasn't been swapped
+// returned value: file length in the upper 32 bits, negative if the file wasn't found
 long long int scd_open_file(const char *name) SCD_CODE_ATTR;
 
+// scd_invalidate_file_cache forgets all cached scd_open_file results
+// the cache is also invalidated by scd_init_pcm, whenever scd_get_disc_info
+// reports that there's no disc or the tray is open and when scd_open_file finds
+// another disc in the drive
+void scd_invalidate_file_cache(void) SCD_CODE_ATTR;
+
 // scd_upload_buf copies data to word RAM and sends a request to the SegaCD
 // to copy it to an internal buffer in program RAM
 //
 // value range for buf_id: [1, 256]
-// the sample must be under 128KiB due to word RAM limitations in 1M mode
+// the sample must not exceed SCD_WORD_RAM_SIZE due to word RAM limitations in 1M mode,
+// larger samples are rejected
 // the passed data can be a WAV file, for which unsigned 8-bit PCM, IMA ADPCM (codec id: 0x11) 
 // or otherwise raw unsigned 8-bit PCM 
 // data is assumed
+// stereo IMA ADPCM WAV files are decoded to unsigned 8-bit stereo PCM by the main CPU
+// while they are copied to word RAM, the decoded data must not exceed SCD_WORD_RAM_SIZE
 //
 // replacing data in a previously initialized buffer of sufficient size is supported
 // otherwise a new memory block will be allocated from the available memory pool
 // once the driver runs out of memory, no further allocations will be possible and
-// the driver will have to be re-initialized by calling scd_init_pcm 
-void scd_upload_buf(u16 buf_id, const u8 *data, u32 data_len) SCD_CODE_ATTR;
+// the driver will have to be re-initialized by calling scd_init_pcm,
+// use scd_alloc_buf and scd_free_buf to reuse buffers between sample sets
+//
+// returned value: 1 if the data has been uploaded, 0 if it was too large
+u8 scd_upload_buf(u16 buf_id, const u8 *data, u32 data_len) SCD_CODE_ATTR;
 
 // scd_upload_buf_fileofs
 void scd_upload_buf_fileofs(u16 buf_id, int numsfx, const u8 *data) SCD_CODE_ATTR;
 
+// scd_upload_native uploads a sample converted with tools/wav2scd or tools/wav2dpcm
+// the data is copied as raw PCM, so the driver doesn't parse a WAV header,
+// and the frequency from the header is used whenever the buffer is played or updated with freq 0
+// DPCM samples are decoded while they are copied to word RAM, so they take no
+// decoding time on the Sub-CPU during playback, the decoded size must not exceed
+// SCD_WORD_RAM_SIZE
+// loop points set with scd_buf_set_loop apply as for scd_upload_buf, in samples, and a loop_end
+// of SCD_LOOP_SMPL loops from the loop start in the header to the end of the sample
+//
+// returned value: 1 if the data has been uploaded, 0 if it is not a valid native sample,
+// too large or needs a loop buffer that wasn't given
+u8 scd_upload_native(u16 buf_id, const u8 *data) SCD_CODE_ATTR;
+
+// scd_src_load_native_file loads a sample converted with tools/wav2scd from CD
+// the header can't be read by the main CPU without loading it, so the frequency
+// reported by wav2scd is passed in freq
+void scd_src_load_native_file(const char *filename, int buf_id, u16 freq) SCD_CODE_ATTR;
+
+// scd_load_bank loads every sample of a bank file built with tools/mkbank
+// into consecutive buffers starting at buf_id, with one open and one sequential read
+// index is the .idx file written by mkbank alongside the bank
+//
+// returned value: number of samples loaded, 0 if the index is invalid or the samples
+// don't fit in the buffers from buf_id to SCD_MAX_BUFS
+u16 scd_load_bank(u16 buf_id, const u8 *index) SCD_CODE_ATTR;
+
+// scd_buf_set_ima marks a buffer as holding mono IMA ADPCM for the ADPCM budget,
+// the main CPU can't see the header of samples loaded from CD, so call it after
+// scd_src_load_file, scd_upload_buf_fileofs or scd_load_bank, every upload clears the mark
+void scd_buf_set_ima(u16 buf_id, u8 ima) SCD_CODE_ATTR;
+
+// scd_buf_set_loop sets the loop points used when data is uploaded to the buffer with scd_upload_buf
+// or scd_upload_native, in sample frames from the start of the sample data, the end is exclusive,
+// a loop_end of SCD_LOOP_SMPL uses the loop stored with the sample, if there's one,
+// and a loop_end of 0 uploads the whole sample unchanged, which is the default
+//
+// looped samples are played with autoloop set: the driver always loops from the start
+// of a buffer, so a sample whose loop starts at the first frame is cut at the loop end
+// and looped by the driver, otherwise the loop is split off into loop_buf_id,
+// which scd_run_loops starts on the source once the intro has ended
+// loop_buf_id belongs to the looped sample from then on and is replaced by every upload to buf_id
+// IMA ADPCM loop points are rounded down to the start of a block, stereo IMA ADPCM
+// samples aren't looped
+//
+// value range for loop_buf_id: [1, SCD_MAX_BUFS], not buf_id, unused if the loop starts at 0
+void scd_buf_set_loop(u16 buf_id, u32 loop_start, u32 loop_end, u16 loop_buf_id) SCD_CODE_ATTR;
+
+// scd_run_loops continues sources whose intro has ended with their loop buffer,
+// call it once per frame when samples with loop points are played
+// an intro only counts as ended once it has been seen playing, so it should last longer than
+// a frame, and paused sources are left alone
+// returns the number of sources that were continued
+int scd_run_loops(void) SCD_CODE_ATTR;
+
+// scd_alloc_buf picks a buf_id for a sample of data_len bytes:
+// the smallest freed buffer the data fits in is reused, otherwise an unused buf_id
+// is taken and the driver allocates a new block from the pool on upload
+//
+// the driver never returns memory to the pool, a freed buffer keeps its block and
+// can only be reused for data of the same size or smaller, so load sample sets
+// with the largest samples first
+//
+// returned value: buf_id to pass to scd_upload_buf, 0 if there's no room for the sample
+u16 scd_alloc_buf(u32 data_len) SCD_CODE_ATTR;
+
+// scd_free_buf marks the buffer as free for reuse by scd_alloc_buf
+// sources playing the buffer must be stopped first
+void scd_free_buf(u16 buf_id) SCD_CODE_ATTR;
+
+// scd_get_mem_info reports the sample memory usage as tracked on the main CPU side
+void scd_get_mem_info(scd_mem_info_t *info) SCD_CODE_ATTR;
+
 // scd_clear_pcm stops playback on all channels
 void scd_clear_pcm(void) SCD_CODE_ATTR;
 
@@ -140,5 +471,120 @@ void scd_queue_stop_src(u8 src_id) SCD_CODE_ATTR;
 // queues a scd_clear_pcm call
 void scd_queue_clear_pcm(void) SCD_CODE_ATTR;
 
-// flushes the command queue
+// flushes the command queue, commands overridden by a later queued command are dropped
+// as are updates that wouldn't change the source, all remaining commands are sent in a single batch
+// returns the number of commands sent to the driver
 int scd_flush_cmd_queue(void) SCD_CODE_ATTR;
+
+/* Scheduled Functions */
+// scheduled commands are stamped with a getSubTick() value and kept until scd_run_schedule
+// finds them due, all commands that are due at that point are sent in one batch like
+// scd_flush_cmd_queue does, so sources scheduled for the same tick start in phase
+//
+// the scheduling resolution is how often scd_run_schedule is called, e.g. once per frame
+// from the main loop, commands that are already due are sent on the next call
+
+// schedules a scd_src_play call at tick, returns 0 if the schedule is full
+u8 scd_schedule_play_src(u32 tick, u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
+
+// schedules a scd_src_update call at tick, returns 0 if the schedule is full
+u8 scd_schedule_update_src(u32 tick, u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
+
+// schedules a scd_src_stop call at tick, returns 0 if the schedule is full
+u8 scd_schedule_stop_src(u32 tick, u8 src_id) SCD_CODE_ATTR;
+
+// drops all scheduled commands that haven't been sent yet
+void scd_cancel_schedule(void) SCD_CODE_ATTR;
+
+// sends the scheduled commands that are due together with the command queue
+// returns the number of commands sent to the driver
+int scd_run_schedule(void) SCD_CODE_ATTR;
+
+/* Ramp Functions */
+// ramps and envelopes are stepped on the main CPU by scd_run_ramps, the changed values of
+// all sources are sent in one batch per call and sources whose values didn't change cost nothing
+//
+// ramps start from the values last sent with scd_src_play or scd_src_update, a new
+// scd_src_play, scd_src_stop or scd_clear_pcm cancels them
+
+// scd_src_ramp moves a source parameter to target over duration subticks (1/76800s)
+// e.g. scd_src_ramp(src_id, SCD_RAMP_VOL|SCD_RAMP_STOP, 0, 2*76800) fades out over 2 seconds
+// frequency ramps need the source to be played with a non-zero freq
+//
+// value range for src_id: [1, 8]
+void scd_src_ramp(u8 src_id, u8 param, u16 target, u32 duration) SCD_CODE_ATTR;
+
+// scd_src_set_envelope moves a source parameter through the points one after another,
+// the envelope holds at the end of the sustain point until scd_src_release is called
+// points must stay valid until the envelope is done, e.g. a const array in ROM
+//
+// value range for src_id: [1, 8]
+// value range for sustain: [0, num_points - 1] or SCD_ENV_NO_SUSTAIN
+void scd_src_set_envelope(u8 src_id, u8 param, const scd_env_point_t *points, u8 num_points, u8 sustain) SCD_CODE_ATTR;
+
+// scd_src_release lets the envelopes of the source continue past their sustain points
+void scd_src_release(u8 src_id) SCD_CODE_ATTR;
+
+// scd_src_stop_ramps cancels all ramps and envelopes of the source, the values stay as they are
+void scd_src_stop_ramps(u8 src_id) SCD_CODE_ATTR;
+
+// scd_run_ramps advances the ramps and flushes the command queue, call it once per frame
+// returns the number of commands sent to the driver
+int scd_run_ramps(void) SCD_CODE_ATTR;
+
+/* Async Functions */
+// scd_cmd_submit queues a command for the Sub-CPU and returns immediately
+// arg0, arg1 and arg2 are written to 0xA12010, 0xA12014 and 0xA12018 right before
+// the command is issued
+// if SCD_MAX_ASYNC_CMDS commands are already pending, polls until a slot becomes free
+//
+// commands that pass data in word RAM must only be submitted after scd_cmd_wait_all
+scd_ticket_t scd_cmd_submit(char cmd, u32 arg0, u32 arg1, u32 arg2) SCD_CODE_ATTR;
+
+// scd_cmd_poll advances the handshake with the Sub-CPU without blocking
+// can be called from the main loop or the VBlank callback
+//
+// returned value: number of commands that are still pending
+u16 scd_cmd_poll(void) SCD_CODE_ATTR;
+
+// scd_cmd_done returns 1 once the command has been acknowledged by the Sub-CPU
+u8 scd_cmd_done(scd_ticket_t ticket) SCD_CODE_ATTR;
+
+// scd_cmd_result returns the first long of the command result (0xA12020)
+// only valid once scd_cmd_done has returned 1 for the ticket
+u32 scd_cmd_result(scd_ticket_t ticket) SCD_CODE_ATTR;
+
+// scd_cmd_wait polls until the command is done and returns its result
+u32 scd_cmd_wait(scd_ticket_t ticket) SCD_CODE_ATTR;
+
+// scd_cmd_wait_all polls until all pending commands are done
+void scd_cmd_wait_all(void) SCD_CODE_ATTR;
+
+// scd_get_stats fills in the command and memory statistics gathered on the main CPU side,
+// along with the playback status registers, without a handshake
+void scd_get_stats(scd_stats_t *stats) SCD_CODE_ATTR;
+
+// scd_reset_stats clears the command counters and latency figures
+void scd_reset_stats(void) SCD_CODE_ATTR;
+
+// async variant of scd_src_play, use scd_src_play_result to get the source id
+scd_ticket_t scd_src_play_async(u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
+
+// scd_src_play_result returns the source id for a completed scd_src_play_async call
+u8 scd_src_play_result(scd_ticket_t ticket) SCD_CODE_ATTR;
+
+// async variant of scd_src_play_steal, the stolen source is known right away,
+// use scd_src_play_result to get the source id
+scd_ticket_t scd_src_play_steal_async(u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop, u8 policy, u8 *stolen_src) SCD_CODE_ATTR;
+
+// async variant of scd_src_update
+scd_ticket_t scd_src_update_async(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
+
+// async variant of scd_src_stop
+scd_ticket_t scd_src_stop_async(u8 src_id) SCD_CODE_ATTR;
+
+// async variant of scd_src_get_pos, use scd_src_get_pos_result to get the position
+scd_ticket_t scd_src_get_pos_async(u8 src_id) SCD_CODE_ATTR;
+
+// scd_src_get_pos_result returns the position for a completed scd_src_get_pos_async call
+u16 scd_src_get_pos_result(scd_ticket_t ticket) SCD_CODE_ATTR;
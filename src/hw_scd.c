@@ -6,14 +6,6 @@ extern void Kos_Decomp(u8 *src, u8 *dst);
 
 int memcmp2(const void *ptr1, const void *ptr2, u32 num);
 
-void *memset2(void *ptr, int value, u32 num) {
-    unsigned char *p = (unsigned char *)ptr;
-    while (num--) {
-        *p++ = (unsigned char)value;
-    }
-    return ptr;
-}
-
 int memcmp2(const void *ptr1, const void *ptr2, u32 num) {
     const unsigned char *p1 = (const unsigned char *)ptr1;
     const unsigned char *p2 = (const unsigned char *)ptr2;
@@ -29,6 +21,16 @@ int memcmp2(const void *ptr1, const void *ptr2, u32 num) {
     return 0;
 }
 
+#if !defined(__m68k__)
+// on the 68000 these are provided by the block copy/fill routines in mem.s
+void *memset2(void *ptr, int value, u32 num) {
+    unsigned char *p = (unsigned char *)ptr;
+    while (num--) {
+        *p++ = (unsigned char)value;
+    }
+    return ptr;
+}
+
 void *custom_memcpy(void *dest, const void *src, u32 n) {
     // Cast source and destination to char pointers
     unsigned char *d = (unsigned char *)dest;
@@ -41,14 +43,10 @@ void *custom_memcpy(void *dest, const void *src, u32 n) {
 
     return dest;
 }
+#endif
 
 void secondInt() {
-    __asm__ (
-        "lea 0xA12000, %a0\n"   // Load address 0xA12000 into register a0
-        "move.w (%a0), %d0\n"    // Load 16-bit value from address in a0 into d0
-        "ori.w #0x0100, %d0\n"   // OR the value in d0 with 0x0100
-        "move.w %d0, (%a0)\n"    // Store the modified value back into address a0
-    );
+    write_word(0xA12000, read_word(0xA12000) | 0x0100); // raise level 2 interrupt on the Sub-CPU
 }
 
 u16 InitCd(void) {
@@ -61,16 +59,16 @@ u16 InitCd(void) {
      * 0x400000 instead of 0x000000. So the BIOS ROM is at 0x400000, the
      * Program RAM bank is at 0x420000, and the Word RAM is at 0x600000.
      */
-    bios = (char *)0x415800;
+    bios = (char *)MD_MEM(0x415800);
     if (memcmp2(bios + 0x6D, "SEGA", 4))  // Check if the BIOS starts with "SEGA"
     {
-        bios = (char *)0x416000;
+        bios = (char *)MD_MEM(0x416000);
         if (memcmp2(bios + 0x6D, "SEGA", 4))  // Check if the BIOS starts with "SEGA"
         {
             // Check for WonderMega/X'Eye
             if (memcmp2(bios + 0x6D, "WONDER", 6))  // Check if the BIOS starts with "WONDER"
             {
-                bios = (char *)0x41AD00; // Might also be 0x40D500
+                bios = (char *)MD_MEM(0x41AD00); // Might also be 0x40D500
                 // Check for LaserActive
                 if (memcmp2(bios + 0x6D, "SEGA", 4))  // Check if the BIOS starts with "SEGA"
                     return 0; // no CD
@@ -98,13 +96,13 @@ u16 InitCd(void) {
     * Decompress Sub-CPU BIOS to Program RAM at 0x00000
     */
     write_word(0xA12002, 0x0002); // no write-protection, bank 0, 2M mode, Word RAM assigned to Sub-CPU
-    memset2((char *)0x420000, 0, 0x20000); // clear program ram first bank - needed for the LaserActive
-    Kos_Decomp((u8 *)bios, (u8 *)0x420000);
+    memset2((char *)MD_MEM(0x420000), 0, 0x20000); // clear program ram first bank - needed for the LaserActive
+    Kos_Decomp((u8 *)bios, (u8 *)MD_MEM(0x420000));
 
     /*
     * Copy Sub-CPU program (fusion driver) to Program RAM at 0x06000
     */
-    custom_memcpy((void *)0x426000, &scd_fusion_driver, sizeof(scd_fusion_driver));
+    custom_memcpy(MD_MEM(0x426000), &scd_fusion_driver, sizeof(scd_fusion_driver));
 
     write_byte(0xA1200E, 0x00); // clear main comm port
     write_byte(0xA12002, 0x2A); // write-protect up to 0x05400
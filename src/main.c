@@ -31,6 +31,11 @@
 #define POS_UD 23
 #define POS_MODE 24
 
+#define POS_LATENCY 26
+#define POS_MEMORY 27
+
+#define DISC_POLL_LOOPS 30 // the disc status costs a handshake, read it about once a second
+
 u16 cd_ok = 0;
 char text[44] = {0};
 u16 buttons = 0, previous = 0, first_track = 0, last_track = 0, curr_track = 1, prev_track = 0;
@@ -51,8 +56,13 @@ union {
     long long int value;
 } track_info;
 
+scd_stats_t stats;
+scd_src_info_t src_state[SCD_MAX_SRCS];
+scd_cdda_timecode_t cdda_time;
+
 u16 bios_stat = 0;
 u16 bios_previous_stat = 0;
+u16 disc_poll = 0; // loops until the disc status is read again
 
 void inialiseVars();
 void delay(s16 vblanks);
@@ -93,6 +103,7 @@ int pcmDisplay()
     
     // Load wavs from CD to CD RAM
     scd_src_load_file("MACABRE.WAV", 1);
+    scd_buf_set_ima(1, 1); // counts towards the ADPCM budget
     scd_src_load_file("STEREOU8.WAV", 2);
     
     SYS_doVBlankProcess();
@@ -116,6 +127,9 @@ int pcmDisplay()
 
     VDP_drawText("SPCM Status:", 2, POS_SPCM_STATUS);
 
+    VDP_drawText("Cmd Latency:", 2, POS_LATENCY);
+    VDP_drawText("Sample Mem:", 2, POS_MEMORY);
+
     // Change to white text using PAL 0
     VDP_setTextPalette(PAL0);
 
@@ -154,8 +168,15 @@ int pcmDisplay()
             VDP_drawText("STOPPED", 15, POS_SPCM_STATUS);
         }
 
-        // Draw the postion in the last source (SPCM not supported)
-        sprintf(text, "%04X", scd_src_get_pos(last_src));
+        // Draw the postion in the last source (SPCM not supported), the position is
+        // requested without waiting and shows up in the state mirror once answered
+        scd_src_get_state_all(src_state);
+        if (last_src >= 1 && last_src <= SCD_MAX_SRCS) {
+            scd_src_get_pos_async(last_src);
+            sprintf(text, "%04X", src_state[last_src - 1].pos);
+        } else {
+            sprintf(text, "%04X", 0);
+        }
         VDP_drawText(text, 15, POS_LAST_SOURCE);
 
         // Draw last position
@@ -170,6 +191,14 @@ int pcmDisplay()
         sprintf(text, "%03d", (u16)vol);
         VDP_drawText(text, 15, POS_VOLUME);
 
+        // Draw driver statistics, latency is in 1/76800 second units
+        scd_get_stats(&stats);
+        sprintf(text, "%05d MAX %05d", (u16)min(stats.latency_last, 65535), (u16)min(stats.latency_max, 65535));
+        VDP_drawText(text, 15, POS_LATENCY);
+
+        sprintf(text, "%03dK USED %03dK FREE", (u16)(stats.mem.used >> 10), (u16)(stats.mem.largest_free >> 10));
+        VDP_drawText(text, 15, POS_MEMORY);
+
     }
 
     /*
@@ -293,6 +322,7 @@ int cddaDisplay() {
     VDP_drawText("First Track:", 2, 6);
     VDP_drawText("Last Track:", 2, 7);
     VDP_drawText("Current Track:", 2, 8);
+    VDP_drawText("Play Time:", 2, 9);
     VDP_drawText("Drive Version:", 2, 11);
     VDP_setTextPalette(0);
     VDP_drawText("Current Track", 2, 13);
@@ -302,7 +332,7 @@ int cddaDisplay() {
     VDP_setTextPalette(0);
     VDP_drawText("A     = Play", 2, 17);
     VDP_drawText("B     = Pause", 2, 18);
-    VDP_drawText("C     = Stop", 2, 19);
+    VDP_drawText("C     = Fade out and stop", 2, 19);
     VDP_drawText("L/R   = Track previous/next", 2, 20);
 
     u8 first_tno = 255, last_tno = 255, drv_ver = 255, flag = 255;
@@ -311,8 +341,12 @@ int cddaDisplay() {
     while (1)
     {
 
-        // Get information regarding the disc
-        disc_info.value = scd_get_disc_info();
+        // Get information regarding the disc, the play time below doesn't need it
+        if (!disc_poll) {
+            disc_info.value = scd_get_disc_info();
+            disc_poll = DISC_POLL_LOOPS;
+        }
+        disc_poll--;
         
         bios_stat = disc_info.lo[0];                  // Status 
         first_tno = ((disc_info.lo[1] >> 8) & 0xFF);  // First track number  
@@ -328,6 +362,12 @@ int cddaDisplay() {
         
         // get controller input
         cddaCtrlInput();
+
+        // step the fade out and draw the play time, neither needs a handshake
+        scd_run_cdda();
+        scd_cdda_get_timecode(&cdda_time);
+        sprintf(text, "%02d:%02d:%02d", (u16)(cdda_time.rel / 4500), (u16)(cdda_time.rel / 75 % 60), (u16)(cdda_time.rel % 75));
+        VDP_drawText(text, 17, 9);
         
         // check if the CD's status has change since the last time and update if it has
         if (bios_previous_stat != bios_stat)
@@ -454,9 +494,12 @@ void cddaCtrlInput()
     }
     if (((buttons ^ previous) & BUTTON_C) && (buttons & BUTTON_C))
     {   
-        scd_cdda_stop_track();
+        scd_cdda_fade(0, 2*76800, 1); // two seconds
     }
 
+    if (buttons & ~previous)
+        disc_poll = 0; // show the effect of the button on the next loop
+
     previous = buttons;
 
 }
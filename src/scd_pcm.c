@@ -1,3 +1,4 @@
+#include "../inc/hw_md.h"
 #include "../inc/scd_pcm.h"
 
 typedef struct
@@ -6,228 +7,1709 @@ typedef struct
     u16 arg[6];
 } scd_cmd_t;
 
+typedef struct
+{
+    u32 arg[3]; // written to 0xA12010, 0xA12014 and 0xA12018 before the command is issued
+    u32 res[2]; // read from 0xA12020 and 0xA12024 once the command is acknowledged
+    u32 time; // subtick count at submission
+    u16 loop_buf; // play commands: buffer the source continues with once it reaches the end
+    char cmd;
+    u8 pending; // counted by scd_src_pending until acknowledged
+} scd_async_cmd_t;
+
+typedef struct
+{
+    scd_cmd_t cmd;
+    u32 tick; // subtick count at which the command is due
+} scd_sched_cmd_t;
+
 #define MAX_SCD_CMDS    16
 
-extern void write_byte(unsigned int dst, unsigned char val);
-extern void write_word(unsigned int dst, unsigned short val);
-extern void write_long(unsigned int dst, unsigned int val);
-extern unsigned char read_byte(unsigned int src);
-extern unsigned short read_word(unsigned int src);
-extern unsigned int read_long(unsigned int src);
-extern void *custom_memcpy(void *dest, const void *src, u32 n);
+#define SCD_FILE_CACHE_SIZE 16
+#define SCD_FILE_NAME_LEN   16 // including the terminating NUL, longer names aren't cached
+
+typedef struct
+{
+    char name[SCD_FILE_NAME_LEN];
+    long long int handle;
+} scd_file_cache_t;
+
+#define SCD_BUF_UNUSED  0 // never uploaded, taking it allocates from the driver pool
+#define SCD_BUF_USED    1
+#define SCD_BUF_FREED   2 // keeps its driver memory, can be reused for data that fits
+
+typedef struct
+{
+    u16 freq;
+    u8 pan;
+    u8 vol;
+    u8 autoloop;
+    u8 valid;       // the values match the last play/update command submitted for the source
+    u16 buf_id;     // buffer of the last play command submitted for the source
+} scd_src_shadow_t;
+
+typedef struct
+{
+    const scd_env_point_t *env; // points of the envelope, &single for a plain ramp
+    scd_env_point_t single;
+    u32 start;      // subtick count at the start of the current segment
+    u32 duration;
+    u16 from;
+    u16 to;
+    u8 num_points;
+    u8 point;       // current segment
+    u8 sustain;     // segment to hold at until released, SCD_ENV_NO_SUSTAIN if none
+    u8 flags;
+} scd_ramp_t;
+
+#define SCD_RAMP_ACTIVE     1
+#define SCD_RAMP_RELEASED   2
+#define SCD_RAMP_STOPS      4 // stop the source once the ramp is done
+
+#define SCD_NUM_RAMP_PARAMS 3
+
+#define SCD_BUF_IMA     1 // mono IMA ADPCM, decoded by the Sub-CPU while playing
+
+typedef struct
+{
+    u16 buf_id;     // buffer last started on the source, 0 if stopped
+    u8 vol;
+    u8 priority;
+    u32 start;      // subtick count when the play command was submitted
+    u16 pos;        // last position returned by a 'G' command
+    u8 paused;
+    u8 autoloop;
+    u32 pos_time;   // subtick count when pos was read, 0 if unknown
+    u16 loop_buf;   // buffer to continue with once the intro buffer ends, 0 if none
+    u8 intro_seen;  // the playback mask has shown the intro playing
+    u8 ima_pending; // IMA ADPCM plays submitted on the source that haven't been acknowledged yet
+    u8 stop_pending; // stops submitted on the source that haven't been acknowledged yet
+} scd_src_state_t;
+
+extern void *custom_memcpy(void *dest, const void *src, u32 n);
+extern int memcmp2(const void *ptr1, const void *ptr2, u32 num);
+
+int mystrlen(const char* string);
+
+// delta per DPCM nibble, must match tools/wav2dpcm.c
+static const s8 scd_dpcm4_deltas[16] = {
+    -64, -34, -21, -13, -8, -5, -3, -1, 0, 1, 3, 5, 8, 13, 21, 34
+};
+
+static const u16 scd_ima_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const s8 scd_ima_index[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static scd_cmd_t scd_cmds[MAX_SCD_CMDS];
+static s16 num_scd_cmds;
+
+static scd_sched_cmd_t scd_sched_cmds[SCD_MAX_SCHED_CMDS]; // sorted by tick
+static s16 num_scd_sched_cmds;
+
+static u32 scd_buf_len[SCD_MAX_BUFS]; // size of the driver memory block behind each buf_id
+static u8 scd_buf_state[SCD_MAX_BUFS];
+static u16 scd_buf_freq[SCD_MAX_BUFS]; // default frequency for native samples, 0 for WAV files
+static u8 scd_buf_flags[SCD_MAX_BUFS];
+static u16 scd_buf_link[SCD_MAX_BUFS]; // loop buffer of a buffer that holds the intro of a looped sample
+static u32 scd_buf_loop_start[SCD_MAX_BUFS]; // loop points for the next upload, in sample frames
+static u32 scd_buf_loop_end[SCD_MAX_BUFS];
+static u16 scd_buf_loop_buf[SCD_MAX_BUFS]; // buffer the loop is split off into
+
+static scd_src_state_t scd_srcs[SCD_MAX_SRCS];
+static scd_src_shadow_t scd_src_shadow[SCD_MAX_SRCS];
+static scd_ramp_t scd_ramps[SCD_MAX_SRCS][SCD_NUM_RAMP_PARAMS];
+static u8 scd_adpcm_budget = SCD_DEFAULT_ADPCM_BUDGET;
+static u8 scd_ima_pending_any; // IMA ADPCM plays submitted with src_id 255 that haven't been acknowledged yet
+static u8 scd_clear_pending; // clears submitted that haven't been acknowledged yet
+static u32 scd_pool_used; // bytes allocated from the driver sample pool
+
+static char scd_spcm_names[SCD_SPCM_PLAYLIST_SIZE][SCD_FILE_NAME_LEN]; // ring of tracks queued after the current one
+static u8 scd_spcm_repeat[SCD_SPCM_PLAYLIST_SIZE];
+static u8 scd_spcm_head;
+static u8 scd_spcm_queued;
+static u8 scd_spcm_started; // the current track has been seen playing
+static s16 scd_spcm_index = -1;
+static s16 scd_spcm_stopped_index = -1; // index of the track scd_spcm_resume_track continues
+static u32 scd_spcm_time; // playback time of the current track up to scd_spcm_clock
+static u32 scd_spcm_clock; // subtick count the playback time was last brought up to date at
+static u8 scd_spcm_running;
+
+static scd_cdda_track_t scd_toc[SCD_MAX_TRACKS]; // indexed by track number - 1
+static u8 scd_toc_first; // first and last track of the disc, 0 if the table isn't filled in
+static u8 scd_toc_last;
+
+static u16 scd_cdda_track; // track started by scd_cdda_play_track, 0 if stopped
+static u8 scd_cdda_repeat;
+static u8 scd_cdda_paused;
+static u32 scd_cdda_time; // playback time up to scd_cdda_clock, in subticks
+static u32 scd_cdda_clock;
+static u16 scd_cdda_vol = SCD_CDDA_MAX_VOLUME; // last volume sent to the driver
+static u16 scd_cdda_fade_from;
+static u16 scd_cdda_fade_to;
+static u32 scd_cdda_fade_start;
+static u32 scd_cdda_fade_len;
+static u8 scd_cdda_fading; // 1 while fading, 2 if playback stops at the end of the fade
+static u16 scd_cdda_seq_track[SCD_CDDA_SEQUENCE_SIZE]; // ring of tracks queued after the current one
+static u8 scd_cdda_seq_repeat[SCD_CDDA_SEQUENCE_SIZE];
+static u8 scd_cdda_seq_head;
+static u8 scd_cdda_seq_queued;
+static u32 scd_cdda_checked; // subtick count of the last drive status check
+
+static scd_file_cache_t scd_file_cache[SCD_FILE_CACHE_SIZE];
+static u16 scd_file_cache_next; // entry replaced by the next miss
+static u32 scd_disc_id; // start of the last track of the disc the caches were filled from, 0 if unknown
+
+static scd_async_cmd_t scd_async_cmds[SCD_MAX_ASYNC_CMDS];
+static volatile scd_ticket_t scd_async_next; // ticket handed out to the next submitted command
+static volatile scd_ticket_t scd_async_done; // oldest command that hasn't been acknowledged yet
+static volatile u8 scd_async_issued; // the oldest command has been written to the main comm port
+static volatile u8 scd_async_polling;
+static u16 scd_submit_loop_buf; // loop_buf for the next submitted command
+
+static u32 scd_stat_cmds;
+static u32 scd_stat_latency_last;
+static u32 scd_stat_latency_max;
+static u32 scd_stat_latency_total;
+static u32 scd_stat_cmds_avoided;
+
+static void scd_delay(void) SCD_CODE_ATTR;
+static u32 *scd_cmd_res(scd_ticket_t ticket) SCD_CODE_ATTR;
+static void scd_buf_uploaded(u16 buf_id, u32 data_len) SCD_CODE_ATTR;
+static u32 scd_be32(const u8 *p) SCD_CODE_ATTR;
+static void scd_upload_word_ram(u16 buf_id, u32 data_len) SCD_CODE_ATTR;
+static u8 scd_upload_word_ram_looped(u16 buf_id, u32 start, u32 end) SCD_CODE_ATTR;
+static void scd_dpcm4_decode(const u8 *in, u32 num, u8 *out) SCD_CODE_ATTR;
+static u16 scd_le16(const u8 *p) SCD_CODE_ATTR;
+static u32 scd_le32(const u8 *p) SCD_CODE_ATTR;
+static const u8 *scd_wav_chunk(const u8 *wav, u32 wav_len, const char *id, u32 *chunk_len) SCD_CODE_ATTR;
+static u8 scd_upload_ima_stereo(u16 buf_id, const u8 *fmt, const u8 *data, u32 data_len) SCD_CODE_ATTR;
+static void scd_spcm_start(const char *name, int repeat) SCD_CODE_ATTR;
+static void scd_cdda_toc_store(u8 track, scd_ticket_t ticket) SCD_CODE_ATTR;
+static u32 scd_msf_frames(u32 msf) SCD_CODE_ATTR;
+static void scd_disc_check(void) SCD_CODE_ATTR;
+static void scd_cdda_start(u16 track, u16 repeat) SCD_CODE_ATTR;
+static void scd_cdda_run_sequence(void) SCD_CODE_ATTR;
+static void scd_spcm_pause_clock(void) SCD_CODE_ATTR;
+static u8 scd_upload_slice(u16 buf_id, const u8 *fmt, u32 fmt_len, const u8 *pcm, u32 len) SCD_CODE_ATTR;
+static u8 scd_upload_looped(u16 buf_id, const u8 *data, u32 data_len, const u8 *fmt, u32 fmt_len) SCD_CODE_ATTR;
+static s16 scd_coalesce_cmd_queue(void) SCD_CODE_ATTR;
+static void scd_src_track(const scd_async_cmd_t *c) SCD_CODE_ATTR;
+static u8 scd_src_pending(char cmd, u32 arg0, s8 delta) SCD_CODE_ATTR;
+static u8 scd_src_admit(u8 src_id, u16 buf_id) SCD_CODE_ATTR;
+static u8 scd_src_victim(u8 policy) SCD_CODE_ATTR;
+static void scd_src_shadow_submit(char cmd, u32 arg0, u32 arg1, u32 arg2) SCD_CODE_ATTR;
+static u8 scd_src_update_redundant(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop) SCD_CODE_ATTR;
+static u16 scd_src_freq(u8 src_id, u16 freq) SCD_CODE_ATTR;
+static scd_cmd_t *scd_schedule(u32 tick) SCD_CODE_ATTR;
+static void scd_ramp_start(u8 src_id, u8 param, const scd_env_point_t *points, u8 num_points, u8 sustain) SCD_CODE_ATTR;
+static u16 scd_ramp_step(scd_ramp_t *r, u32 now, u8 *stop) SCD_CODE_ATTR;
+
+/* Initialize Function */
+void scd_init_pcm(void)
+{
+    u16 i;
+
+    /*
+    * Initialize the PCM driver
+    */
+    scd_cmd_wait(scd_cmd_submit('I', 0, 0, 0));
+
+    // the driver frees all sample memory on initialization
+    memset(scd_buf_len, 0, sizeof(scd_buf_len));
+    memset(scd_buf_state, SCD_BUF_UNUSED, sizeof(scd_buf_state));
+    memset(scd_buf_freq, 0, sizeof(scd_buf_freq));
+    memset(scd_buf_flags, 0, sizeof(scd_buf_flags));
+    memset(scd_buf_link, 0, sizeof(scd_buf_link));
+    memset(scd_buf_loop_end, 0, sizeof(scd_buf_loop_end));
+    memset(scd_buf_loop_buf, 0, sizeof(scd_buf_loop_buf));
+    memset(scd_srcs, 0, sizeof(scd_srcs));
+    memset(scd_src_shadow, 0, sizeof(scd_src_shadow));
+    memset(scd_ramps, 0, sizeof(scd_ramps));
+    for (i = 0; i < SCD_MAX_SRCS; i++)
+        scd_srcs[i].priority = SCD_PRIORITY_DEFAULT;
+    scd_ima_pending_any = 0;
+    scd_clear_pending = 0;
+    scd_invalidate_file_cache();
+    scd_cdda_invalidate_toc();
+    scd_disc_id = 0;
+    scd_pool_used = 0;
+}
+
+/* Core SCD Functions */
+static void scd_delay(void)
+{
+    int cnt = 5;
+    do {
+        asm __volatile("nop");
+    } while (--cnt);
+}
+
+int mystrlen(const char* string)
+{
+	volatile int rc = 0;
+
+	while (*(string++))
+		rc++;
+
+	return rc;
+}
+
+/* Async Functions */
+scd_ticket_t scd_cmd_submit(char cmd, u32 arg0, u32 arg1, u32 arg2)
+{
+    scd_async_cmd_t *c;
+
+    while ((scd_ticket_t)(scd_async_next - scd_async_done) >= SCD_MAX_ASYNC_CMDS) {
+        scd_delay(); // all slots are in use, wait for the oldest command to complete
+        scd_cmd_poll();
+    }
+
+    c = scd_async_cmds + (scd_async_next & (SCD_MAX_ASYNC_CMDS - 1));
+    c->cmd = cmd;
+    c->arg[0] = arg0;
+    c->arg[1] = arg1;
+    c->arg[2] = arg2;
+    c->res[0] = 0;
+    c->res[1] = 0;
+    c->time = getSubTick();
+    c->loop_buf = scd_submit_loop_buf;
+    scd_submit_loop_buf = 0;
+    c->pending = scd_src_pending(cmd, arg0, 1);
+
+    scd_src_shadow_submit(cmd, arg0, arg1, arg2);
+    return scd_async_next++;
+}
+
+u16 scd_cmd_poll(void)
+{
+    scd_async_cmd_t *c;
+
+    if (scd_async_polling) {
+        // called from the VBlank callback while the main loop is polling or the other way around
+        return (scd_ticket_t)(scd_async_next - scd_async_done);
+    }
+    scd_async_polling = 1;
+
+    while (scd_async_done != scd_async_next) {
+        c = scd_async_cmds + (scd_async_done & (SCD_MAX_ASYNC_CMDS - 1));
+
+        if (!c->cmd) {
+            scd_async_done++; // dropped command, completes without a handshake
+            continue;
+        }
+
+        if (!scd_async_issued) {
+            if (read_byte(0xA1200F)) {
+                break; // Sub-CPU is not ready to receive command yet
+            }
+            write_long(0xA12010, c->arg[0]);
+            write_long(0xA12014, c->arg[1]);
+            write_long(0xA12018, c->arg[2]);
+            write_byte(0xA1200E, c->cmd); // set main comm port to command
+            scd_async_issued = 1;
+        }
+
+        if (!read_byte(0xA1200F)) {
+            break; // no acknowledge byte in sub comm port yet
+        }
+        c->res[0] = read_long(0xA12020);
+        c->res[1] = read_long(0xA12024);
+        write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+
+        scd_stat_latency_last = getSubTick() - c->time;
+        if (scd_stat_latency_last > scd_stat_latency_max)
+            scd_stat_latency_max = scd_stat_latency_last;
+        scd_stat_latency_total += scd_stat_latency_last;
+        scd_stat_cmds++;
+
+        if (c->pending)
+            scd_src_pending(c->cmd, c->arg[0], -1);
+        scd_src_track(c);
+        scd_async_issued = 0;
+        scd_async_done++;
+    }
+
+    scd_async_polling = 0;
+    return (scd_ticket_t)(scd_async_next - scd_async_done);
+}
+
+u8 scd_cmd_done(scd_ticket_t ticket)
+{
+    return (scd_ticket_t)(ticket - scd_async_done) >= (scd_ticket_t)(scd_async_next - scd_async_done);
+}
+
+static u32 *scd_cmd_res(scd_ticket_t ticket)
+{
+    return scd_async_cmds[ticket & (SCD_MAX_ASYNC_CMDS - 1)].res;
+}
+
+u32 scd_cmd_result(scd_ticket_t ticket)
+{
+    return scd_cmd_res(ticket)[0];
+}
+
+u32 scd_cmd_wait(scd_ticket_t ticket)
+{
+    while (!scd_cmd_done(ticket)) {
+        scd_delay();
+        scd_cmd_poll();
+    }
+    return scd_cmd_result(ticket);
+}
+
+void scd_cmd_wait_all(void)
+{
+    while (scd_async_done != scd_async_next) {
+        scd_delay();
+        scd_cmd_poll();
+    }
+}
+
+void scd_get_stats(scd_stats_t *stats)
+{
+    stats->cmds = scd_stat_cmds;
+    stats->pending = (scd_ticket_t)(scd_async_next - scd_async_done);
+    stats->latency_last = scd_stat_latency_last;
+    stats->latency_max = scd_stat_latency_max;
+    stats->latency_avg = scd_stat_cmds ? scd_stat_latency_total / scd_stat_cmds : 0;
+    stats->cmds_avoided = scd_stat_cmds_avoided;
+    stats->playing = read_byte(0xA1202F);
+    stats->spcm_playing = read_byte(0xA1202E);
+    scd_get_mem_info(&stats->mem);
+}
+
+void scd_reset_stats(void)
+{
+    scd_stat_cmds = 0;
+    scd_stat_latency_last = 0;
+    scd_stat_latency_max = 0;
+    scd_stat_latency_total = 0;
+    scd_stat_cmds_avoided = 0;
+}
+
+// keeps the shadow copy of the source properties in sync with submitted commands
+static void scd_src_shadow_submit(char cmd, u32 arg0, u32 arg1, u32 arg2)
+{
+    u8 src_id = (arg0 >> 16) & 0xff;
+    scd_src_shadow_t *shadow;
+
+    if (cmd == 'L') {
+        memset(scd_src_shadow, 0, sizeof(scd_src_shadow));
+        memset(scd_ramps, 0, sizeof(scd_ramps));
+        return;
+    }
+    if (src_id < 1 || src_id > SCD_MAX_SRCS)
+        return; // sources allocated with src_id 255 are picked up on acknowledge
+
+    shadow = scd_src_shadow + src_id - 1;
+    switch (cmd) {
+        case 'A':
+            memset(scd_ramps[src_id - 1], 0, sizeof(scd_ramps[0])); // new sample, new ramps
+            shadow->buf_id = arg0 & 0xffff;
+            // fall through
+        case 'U':
+            shadow->freq = arg1 >> 16;
+            shadow->pan = arg1 & 0xff;
+            shadow->vol = arg2 >> 16;
+            shadow->autoloop = arg2 & 0xff;
+            shadow->valid = 1;
+            break;
+        case 'O':
+            shadow->valid = 0;
+            memset(scd_ramps[src_id - 1], 0, sizeof(scd_ramps[0]));
+            break;
+        default:
+            break;
+    }
+}
+
+// resolves a freq of 0 to the frequency of the native sample the source plays, the driver
+// would fall back to its default rate for raw data, WAV files keep 0 for the rate in their header
+static u16 scd_src_freq(u8 src_id, u16 freq)
+{
+    u16 buf_id;
+
+    if (freq || src_id < 1 || src_id > SCD_MAX_SRCS || !scd_src_shadow[src_id - 1].valid)
+        return freq;
+    buf_id = scd_src_shadow[src_id - 1].buf_id;
+    return (buf_id && buf_id <= SCD_MAX_BUFS) ? scd_buf_freq[buf_id - 1] : 0;
+}
+
+// returns 1 if an update wouldn't change anything the last submitted command hasn't set
+static u8 scd_src_update_redundant(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    scd_src_shadow_t *shadow;
+
+    if (src_id < 1 || src_id > SCD_MAX_SRCS)
+        return 0;
+    freq = scd_src_freq(src_id, freq);
+    shadow = scd_src_shadow + src_id - 1;
+    return shadow->valid && shadow->freq == freq && shadow->pan == pan
+        && shadow->vol == vol && shadow->autoloop == autoloop;
+}
+
+// keeps the main CPU side view of the sources in sync with acknowledged commands
+static void scd_src_track(const scd_async_cmd_t *c)
+{
+    u8 i, src_id = (c->arg[0] >> 16) & 0xff;
+    scd_src_state_t *src;
+
+    switch (c->cmd) {
+        case 'A':
+            src_id = c->res[0] >> 24; // the allocated source for src_id 255
+            if (src_id < 1 || src_id > SCD_MAX_SRCS)
+                break;
+            src = scd_srcs + src_id - 1;
+            src->buf_id = c->arg[0] & 0xffff;
+            src->vol = c->arg[2] >> 16;
+            src->autoloop = c->arg[2] & 0xff;
+            src->paused = 0;
+            src->start = c->time;
+            src->pos_time = 0;
+            src->loop_buf = c->loop_buf;
+            src->intro_seen = 0;
+            if (((c->arg[0] >> 16) & 0xff) == 255) {
+                // the play was admitted at the default priority, not the one last set on the source
+                src->priority = SCD_PRIORITY_DEFAULT;
+                // the source may have ended on its own with ramps still running
+                memset(scd_ramps[src_id - 1], 0, sizeof(scd_ramps[0]));
+                scd_src_shadow[src_id - 1].buf_id = c->arg[0] & 0xffff;
+                scd_src_shadow[src_id - 1].freq = c->arg[1] >> 16;
+                scd_src_shadow[src_id - 1].pan = c->arg[1] & 0xff;
+                scd_src_shadow[src_id - 1].vol = c->arg[2] >> 16;
+                scd_src_shadow[src_id - 1].autoloop = c->arg[2] & 0xff;
+                scd_src_shadow[src_id - 1].valid = 1;
+            }
+            break;
+        case 'U':
+            if (src_id >= 1 && src_id <= SCD_MAX_SRCS) {
+                scd_srcs[src_id - 1].vol = c->arg[2] >> 16;
+                scd_srcs[src_id - 1].autoloop = c->arg[2] & 0xff;
+                if (!(c->arg[2] & 0xff))
+                    scd_srcs[src_id - 1].loop_buf = 0; // looping turned off during the intro
+            }
+            break;
+        case 'N':
+            if (src_id >= 1 && src_id <= SCD_MAX_SRCS)
+                scd_srcs[src_id - 1].paused = c->arg[0] & 0xff;
+            break;
+        case 'G':
+            if (src_id >= 1 && src_id <= SCD_MAX_SRCS) {
+                scd_srcs[src_id - 1].pos = c->res[0] >> 16;
+                scd_srcs[src_id - 1].pos_time = getSubTick() | 1;
+            }
+            break;
+        case 'O':
+            if (src_id >= 1 && src_id <= SCD_MAX_SRCS)
+                scd_srcs[src_id - 1].buf_id = 0;
+            break;
+        case 'L':
+            for (i = 0; i < SCD_MAX_SRCS; i++)
+                scd_srcs[i].buf_id = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+// counts the IMA ADPCM plays, stops and clears that have been submitted but not acknowledged,
+// so scd_src_admit sees commands still waiting in the ring, delta is 1 on submit and -1 on acknowledge
+// returns 1 if the command is counted
+static u8 scd_src_pending(char cmd, u32 arg0, s8 delta)
+{
+    u8 src_id = (arg0 >> 16) & 0xff;
+    u16 buf_id = arg0 & 0xffff;
+
+    switch (cmd) {
+        case 'A':
+            if (!buf_id || buf_id > SCD_MAX_BUFS || !(scd_buf_flags[buf_id - 1] & SCD_BUF_IMA))
+                return 0;
+            if (src_id >= 1 && src_id <= SCD_MAX_SRCS)
+                scd_srcs[src_id - 1].ima_pending += delta;
+            else
+                scd_ima_pending_any += delta;
+            return 1;
+        case 'O':
+            if (src_id < 1 || src_id > SCD_MAX_SRCS)
+                return 0;
+            scd_srcs[src_id - 1].stop_pending += delta;
+            return 1;
+        case 'L':
+            scd_clear_pending += delta;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// keeps the number of playing IMA ADPCM sources within what the Sub-CPU can decode:
+// once the budget is used up, the lowest priority IMA source below the priority of
+// the new one is stopped, if there's none the new one isn't started
+static u8 scd_src_admit(u8 src_id, u16 buf_id)
+{
+    u8 i, n, victim = 0, priority, mask;
+    scd_src_state_t *src;
+
+    if (!buf_id || buf_id > SCD_MAX_BUFS || !(scd_buf_flags[buf_id - 1] & SCD_BUF_IMA))
+        return 1;
+
+    priority = (src_id >= 1 && src_id <= SCD_MAX_SRCS) ? scd_srcs[src_id - 1].priority : SCD_PRIORITY_DEFAULT;
+    mask = read_byte(0xA1202F);
+
+    n = scd_ima_pending_any;
+    for (i = 1, src = scd_srcs; i <= SCD_MAX_SRCS; i++, src++) {
+        if (i == src_id)
+            continue;
+        if (src->ima_pending) {
+            n++; // about to start, whatever the source is playing now
+            continue;
+        }
+        if (src->stop_pending || scd_clear_pending || !(mask & (1 << (i - 1))) || !src->buf_id)
+            continue; // stopped by a command still waiting in the ring
+        if (!(scd_buf_flags[src->buf_id - 1] & SCD_BUF_IMA))
+            continue;
+        n++;
+        if (src->priority < priority && (!victim || src->priority < scd_srcs[victim - 1].priority))
+            victim = i;
+    }
+
+    if (n < scd_adpcm_budget)
+        return 1;
+    if (!victim)
+        return 0;
+    scd_src_stop_async(victim);
+    return 1;
+}
+
+void scd_src_get_state_all(scd_src_info_t *state)
+{
+    u8 i, mask = read_byte(0xA1202F);
+    scd_src_state_t *src;
+
+    for (i = 0, src = scd_srcs; i < SCD_MAX_SRCS; i++, src++, state++) {
+        state->buf_id = src->buf_id;
+        state->pos = src->pos;
+        state->pos_time = src->pos_time;
+        state->vol = src->vol;
+        state->priority = src->priority;
+        state->flags = 0;
+        if (mask & (1 << i))
+            state->flags |= SCD_SRC_PLAYING;
+        if (src->buf_id && src->paused)
+            state->flags |= SCD_SRC_PAUSED;
+        if (src->buf_id && src->autoloop)
+            state->flags |= SCD_SRC_LOOPING;
+    }
+}
+
+void scd_src_set_priority(u8 src_id, u8 priority)
+{
+    if (src_id >= 1 && src_id <= SCD_MAX_SRCS)
+        scd_srcs[src_id - 1].priority = priority;
+}
+
+void scd_set_adpcm_budget(u8 max_srcs)
+{
+    scd_adpcm_budget = max_srcs;
+}
+
+// picks the source to reuse when all of them are playing, 0 if none qualifies
+static u8 scd_src_victim(u8 policy)
+{
+    u8 i, victim = 0;
+    scd_src_state_t *src, *best = NULL;
+
+    for (i = 1, src = scd_srcs; i <= SCD_MAX_SRCS; i++, src++) {
+        if (policy == SCD_STEAL_PRIORITY && src->priority > SCD_PRIORITY_DEFAULT)
+            continue;
+        if (best) {
+            if (policy == SCD_STEAL_QUIETEST && src->vol != best->vol) {
+                if (src->vol > best->vol)
+                    continue;
+            } else if (policy == SCD_STEAL_PRIORITY && src->priority != best->priority) {
+                if (src->priority > best->priority)
+                    continue;
+            } else if ((s32)(src->start - best->start) >= 0) {
+                continue;
+            }
+        }
+        best = src;
+        victim = i;
+    }
+    return victim;
+}
+
+scd_ticket_t scd_src_play_steal_async(u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop, u8 policy, u8 *stolen_src)
+{
+    u8 src_id = 255, victim = 0;
+
+    if (policy != SCD_STEAL_NONE && read_byte(0xA1202F) == 0xFF) {
+        scd_cmd_wait_all(); // so the source view reflects everything submitted so far
+        if (read_byte(0xA1202F) == 0xFF) {
+            victim = scd_src_victim(policy);
+            if (victim) {
+                scd_src_stop_async(victim);
+                src_id = victim;
+            }
+        }
+    }
+
+    if (stolen_src)
+        *stolen_src = victim;
+    return scd_src_play_async(src_id, buf_id, freq, pan, vol, autoloop);
+}
+
+u8 scd_src_play_steal(u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop, u8 policy, u8 *stolen_src)
+{
+    scd_ticket_t t = scd_src_play_steal_async(buf_id, freq, pan, vol, autoloop, policy, stolen_src);
+    scd_cmd_wait(t);
+    return scd_src_play_result(t);
+}
+
+scd_ticket_t scd_src_play_async(u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    if (!freq && buf_id && buf_id <= SCD_MAX_BUFS)
+        freq = scd_buf_freq[buf_id - 1]; // native samples carry no WAV header
+    if (!scd_src_admit(src_id, buf_id))
+        return scd_cmd_submit(0, 0, 0, 0); // not started, the result is 0
+    if (autoloop && buf_id && buf_id <= SCD_MAX_BUFS && scd_buf_link[buf_id - 1]) {
+        // the intro plays once, scd_run_loops continues with the loop buffer
+        scd_submit_loop_buf = scd_buf_link[buf_id - 1];
+        autoloop = 0;
+    }
+    return scd_cmd_submit('A', // SfxPlaySource command
+        ((unsigned)src_id<<16)|buf_id, /* src|buf_id */
+        ((unsigned)freq<<16)|pan, /* freq|pan */
+        ((unsigned)vol<<16)|autoloop); /* vol|autoloop */
+}
+
+u8 scd_src_play_result(scd_ticket_t ticket)
+{
+    return scd_cmd_result(ticket) >> 24;
+}
+
+scd_ticket_t scd_src_update_async(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    freq = scd_src_freq(src_id, freq);
+    if (scd_src_update_redundant(src_id, freq, pan, vol, autoloop)) {
+        scd_stat_cmds_avoided++;
+        return scd_cmd_submit(0, 0, 0, 0); // nothing would change
+    }
+    return scd_cmd_submit('U', // SfxUpdateSource command
+        ((unsigned)src_id<<16), /* src|0 */
+        ((unsigned)freq<<16)|pan, /* freq|pan */
+        ((unsigned)vol<<16)|autoloop); /* vol|autoloop */
+}
+
+scd_ticket_t scd_src_stop_async(u8 src_id)
+{
+    return scd_cmd_submit('O', ((unsigned)src_id<<16), 0, 0); // SfxStopSource command
+}
+
+scd_ticket_t scd_src_get_pos_async(u8 src_id)
+{
+    return scd_cmd_submit('G', ((unsigned)src_id<<16), 0, 0); // SfxGetSourcePosition command
+}
+
+u16 scd_src_get_pos_result(scd_ticket_t ticket)
+{
+    return scd_cmd_result(ticket) >> 16;
+}
+
+/* SPCM Functions */
+static void scd_spcm_start(const char *name, int repeat)
+{
+    char *scdWordRam = (char *)MD_MEM(0x600000); /* word ram on MD side (in 1M mode) */
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+    custom_memcpy(scdWordRam, name, mystrlen(name)+1);
+    scd_cmd_wait(scd_cmd_submit('Q', // PlaySPCMTrack command
+        0x0C0000, /* word ram on CD side (in 1M mode) */
+        repeat, 0));
+    scd_spcm_started = 0;
+    scd_spcm_time = 0;
+    scd_spcm_running = 0; // started by scd_run_spcm once the track is seen playing
+}
+
+static void scd_spcm_pause_clock(void)
+{
+    if (scd_spcm_running)
+        scd_spcm_time += getSubTick() - scd_spcm_clock;
+    scd_spcm_running = 0;
+}
+
+void scd_spcm_play_track(const char *name, int repeat)
+{
+    scd_spcm_queued = 0;
+    scd_spcm_index = 0;
+    scd_spcm_start(name, repeat);
+}
+
+void scd_spcm_stop_track()
+{
+    scd_cmd_wait(scd_cmd_submit('R', 0, 0, 0)); // StopSPCMTrack command
+    scd_spcm_pause_clock();
+    scd_spcm_queued = 0;
+    if (scd_spcm_index >= 0)
+        scd_spcm_stopped_index = scd_spcm_index;
+    scd_spcm_index = -1;
+}
+
+u8 scd_spcm_queue_track(const char *name, int repeat)
+{
+    u8 i;
+
+    if (scd_spcm_queued >= SCD_SPCM_PLAYLIST_SIZE || mystrlen(name) >= SCD_FILE_NAME_LEN)
+        return 0;
+
+    if (scd_spcm_index < 0) {
+        scd_spcm_play_track(name, repeat); // nothing to wait for
+        return 1;
+    }
+
+    i = (scd_spcm_head + scd_spcm_queued) % SCD_SPCM_PLAYLIST_SIZE;
+    strcpy(scd_spcm_names[i], name);
+    scd_spcm_repeat[i] = repeat;
+    scd_spcm_queued++;
+
+    if (scd_spcm_started && !(read_byte(0xA1202E) & 1))
+        scd_spcm_next_track(); // the last track has already ended
+    return 1;
+}
+
+u8 scd_spcm_next_track(void)
+{
+    u8 i = scd_spcm_head;
+
+    if (!scd_spcm_queued)
+        return 0;
+
+    scd_spcm_head = (scd_spcm_head + 1) % SCD_SPCM_PLAYLIST_SIZE;
+    scd_spcm_queued--;
+    scd_spcm_index++;
+    scd_spcm_start(scd_spcm_names[i], scd_spcm_repeat[i]);
+    return 1;
+}
+
+int scd_run_spcm(void)
+{
+    if (read_byte(0xA1202E) & 1) {
+        if (!scd_spcm_started) {
+            // opening the file, seeking and filling the buffer take a while after 'Q' or 'X'
+            scd_spcm_clock = getSubTick();
+            scd_spcm_running = 1;
+        }
+        scd_spcm_started = 1;
+    } else if (scd_spcm_started) {
+        scd_spcm_pause_clock();
+        scd_spcm_next_track(); // ended, start the next track right away
+    }
+    return scd_spcm_index;
+}
+
+u32 scd_spcm_get_time(void)
+{
+    if (!scd_spcm_running)
+        return scd_spcm_time;
+    return scd_spcm_time + (getSubTick() - scd_spcm_clock);
+}
+
+int scd_spcm_get_playlist_index(void)
+{
+    return scd_spcm_index;
+}
+
+void scd_spcm_resume_track(void)
+{
+    scd_cmd_wait(scd_cmd_submit('X', 0, 0, 0)); // ResumeSPCMTrack command
+    scd_spcm_pause_clock();
+    scd_spcm_started = 0; // the status bit is set again once the stream has refilled
+    if (scd_spcm_index < 0)
+        scd_spcm_index = scd_spcm_stopped_index; // playing again, queued tracks wait for it
+}
+
+int scd_spcm_get_playback_status(void)
+{
+    return read_byte(0xA1202E);
+}
+
+/* CDDA Functions */
+long long int scd_get_disc_info(void)
+{
+    u32 *r;
+    union {
+        s16 lo[4];
+        long long int value;
+    } res;
+
+    scd_ticket_t t = scd_cmd_submit('D', 0, 0, 0); // GetDiscInfo command
+    scd_cmd_wait(t);
+    r = scd_cmd_res(t);
+    res.lo[0] = r[0] >> 16; // status
+    res.lo[1] = r[0]; // first and last song
+    res.lo[2] = r[1] >> 16; // drive version, flag 
+    res.lo[3] = 0;
+
+    if ((res.lo[0] >> 8) == 16 || (res.lo[0] >> 8) == 64) {
+        scd_invalidate_file_cache(); // no disc or tray open, the disc may be swapped
+        scd_cdda_invalidate_toc();
+        scd_disc_id = 0;
+    }
+
+    return res.value;
+}
+
+// forgets the file cache and the track table unless the disc they were filled from is still
+// in the drive: a swap is only seen by scd_get_disc_info while the tray is open, which callers
+// may never ask during, so the disc is told apart by the start of its last track
+static void scd_disc_check(void)
+{
+    u16 status, last_track;
+    u32 id = 0;
+    union {
+        s16 lo[4];
+        long long int value;
+    } disc;
+
+    disc.value = scd_get_disc_info();
+    status = (u16)disc.lo[0] >> 8;
+    last_track = disc.lo[1] & 0xff;
+    if (status != 16 && status != 32 && status != 64 && !(status & 0x80)
+        && last_track >= 1 && last_track <= SCD_MAX_TRACKS)
+        id = scd_cmd_wait(scd_cmd_submit('T', (u32)last_track<<16, 0, 0)); // GetTrackInfo command
+
+    if (!id || id != scd_disc_id) {
+        scd_invalidate_file_cache();
+        scd_cdda_invalidate_toc();
+    }
+    scd_disc_id = id;
+}
+
+long long int scd_cdda_get_track_info(u16 track)
+{
+    u32 *r;
+    union {
+        s32 lo[2];
+        long long int value;
+    } res;
+
+    scd_disc_check();
+    scd_cdda_get_toc(NULL, NULL);
+    if (track >= scd_toc_first && track <= scd_toc_last && scd_toc_first) {
+        res.lo[0] = scd_toc[track - 1].start;
+        res.lo[1] = scd_toc[track - 1].type;
+        return res.value;
+    }
+
+    scd_ticket_t t = scd_cmd_submit('T', (u32)track<<16, 0, 0); // GetTrackInfo command
+    scd_cmd_wait(t);
+    r = scd_cmd_res(t);
+    res.lo[0] = r[0]; // MMSSFFTN minutes|seconds|frames|track number|
+    res.lo[1] = (r[1] >> 24) & 0xff; // track type - DATA or CDDA (byte)
+
+    return res.value;
+}
+
+// converts a BCD MMSSFF.. time code to a number of frames (1/75s)
+static u32 scd_msf_frames(u32 msf)
+{
+    u8 m = msf >> 24, s = msf >> 16, f = msf >> 8;
+    return (((m >> 4) * 10 + (m & 15)) * 60 + (s >> 4) * 10 + (s & 15)) * 75 + (f >> 4) * 10 + (f & 15);
+}
+
+static void scd_cdda_toc_store(u8 track, scd_ticket_t ticket)
+{
+    u32 *r;
+
+    scd_cmd_wait(ticket);
+    r = scd_cmd_res(ticket);
+    scd_toc[track - 1].start = r[0];
+    scd_toc[track - 1].type = (r[1] >> 24) & 0xff;
+    scd_toc[track - 1].length = 0;
+}
+
+const scd_cdda_track_t *scd_cdda_get_toc(u8 *first, u8 *last)
+{
+    u16 track, first_track, last_track, status;
+    union {
+        s16 lo[4];
+        long long int value;
+    } disc;
+
+    if (!scd_toc_first) {
+        disc.value = scd_get_disc_info();
+        first_track = (disc.lo[1] >> 8) & 0xff;
+        last_track = disc.lo[1] & 0xff;
+
+        // no disc, tray open, still reading the TOC or not ready
+        status = (u16)disc.lo[0] >> 8;
+        if (status != 16 && status != 32 && status != 64 && !(status & 0x80)
+            && first_track >= 1 && first_track <= last_track && last_track <= SCD_MAX_TRACKS) {
+            for (track = first_track; track <= last_track; track++)
+                scd_cdda_toc_store(track, scd_cmd_submit('T', (u32)track<<16, 0, 0)); // GetTrackInfo command
+
+            // the length of the last track isn't known without the lead-out
+            for (track = first_track; track < last_track; track++)
+                scd_toc[track - 1].length = scd_msf_frames(scd_toc[track].start) - scd_msf_frames(scd_toc[track - 1].start);
+
+            scd_toc_first = first_track;
+            scd_toc_last = last_track;
+            if (scd_toc[last_track - 1].start != scd_disc_id)
+                scd_invalidate_file_cache(); // read from another disc than the cached files
+            scd_disc_id = scd_toc[last_track - 1].start;
+        }
+    }
+
+    if (first)
+        *first = scd_toc_first;
+    if (last)
+        *last = scd_toc_last;
+    return scd_toc;
+}
+
+void scd_cdda_invalidate_toc(void)
+{
+    scd_toc_first = 0;
+    scd_toc_last = 0;
+}
+
+static void scd_cdda_start(u16 track, u16 repeat)
+{
+    scd_disc_check(); // the timecode and the sequence go by the track lengths in the table
+    scd_cmd_wait(scd_cmd_submit('P', // PlayTrack command
+        ((u32)track<<16)|((u32)(repeat & 0xff)<<8), /* track|repeat (byte) */
+        0, 0));
+    scd_cdda_track = track;
+    scd_cdda_repeat = repeat & 0xff;
+    scd_cdda_paused = 0;
+    scd_cdda_time = 0;
+    scd_cdda_clock = getSubTick();
+    scd_cdda_checked = scd_cdda_clock;
+}
+
+void scd_cdda_play_track(u16 track, u16 repeat)
+{
+    scd_cdda_seq_queued = 0;
+    scd_cdda_start(track, repeat);
+}
+
+u8 scd_cdda_queue_track(u16 track, u16 repeat)
+{
+    u8 i;
+
+    if (scd_cdda_seq_queued >= SCD_CDDA_SEQUENCE_SIZE)
+        return 0;
+
+    if (!scd_cdda_track) {
+        scd_cdda_play_track(track, repeat); // nothing to wait for
+        return 1;
+    }
+
+    scd_cdda_get_toc(NULL, NULL); // track lengths tell when to start watching the drive
+    i = (scd_cdda_seq_head + scd_cdda_seq_queued) % SCD_CDDA_SEQUENCE_SIZE;
+    scd_cdda_seq_track[i] = track;
+    scd_cdda_seq_repeat[i] = repeat;
+    scd_cdda_seq_queued++;
+    return 1;
+}
+
+u8 scd_cdda_next_track(void)
+{
+    u8 i = scd_cdda_seq_head;
+
+    if (!scd_cdda_seq_queued)
+        return 0;
+
+    scd_cdda_seq_head = (scd_cdda_seq_head + 1) % SCD_CDDA_SEQUENCE_SIZE;
+    scd_cdda_seq_queued--;
+    scd_cdda_start(scd_cdda_seq_track[i], scd_cdda_seq_repeat[i]);
+    return 1;
+}
+
+// starts the next track of the sequence once the drive has stopped at the end of the current one
+static void scd_cdda_run_sequence(void)
+{
+    scd_cdda_timecode_t tc;
+    u32 len = 0, now = getSubTick();
+    union {
+        s16 lo[4];
+        long long int value;
+    } disc;
+
+    if (!scd_cdda_seq_queued || !scd_cdda_track || scd_cdda_paused)
+        return;
+
+    scd_cdda_get_timecode(&tc);
+    if (scd_toc_first && scd_cdda_track >= scd_toc_first && scd_cdda_track <= scd_toc_last)
+        len = scd_toc[scd_cdda_track - 1].length;
+    if (len && tc.rel < len)
+        return; // not there yet, no need to ask the drive
+
+    // the status is checked four times a second past the expected end of the track
+    if (now - scd_cdda_checked < 76800/4)
+        return;
+    scd_cdda_checked = now;
+
+    disc.value = scd_get_disc_info();
+    if ((disc.lo[0] >> 8) == 0)
+        scd_cdda_next_track(); // stopped
+}
+
+void scd_cdda_stop_track(void)
+{
+    scd_cmd_wait(scd_cmd_submit('S', 0, 0, 0)); // StopPlaying command
+    scd_cdda_track = 0;
+    scd_cdda_fading = 0;
+    scd_cdda_seq_queued = 0;
+}
+
+void scd_cdda_toggle_pause(void)
+{
+    u32 now;
+
+    scd_cmd_wait(scd_cmd_submit('Z', 0, 0, 0)); // PauseResume command
+    now = getSubTick();
+    if (!scd_cdda_paused)
+        scd_cdda_time += now - scd_cdda_clock;
+    scd_cdda_clock = now;
+    scd_cdda_paused ^= 1;
+}
+
+void scd_cdda_set_volume(u16 volume)
+{
+    scd_cmd_wait(scd_cmd_submit('V', (u32)volume<<16, 0, 0)); // SetVolume command
+    scd_cdda_vol = volume;
+    scd_cdda_fading = 0;
+}
+
+void scd_cdda_fade(u16 volume, u32 duration, u8 stop)
+{
+    scd_cdda_fade_from = scd_cdda_vol;
+    scd_cdda_fade_to = volume;
+    scd_cdda_fade_start = getSubTick();
+    scd_cdda_fade_len = duration;
+    scd_cdda_fading = stop ? 2 : 1;
+}
+
+int scd_run_cdda(void)
+{
+    u32 elapsed;
+    u16 vol;
+    u8 stop;
+
+    scd_cdda_run_sequence();
+    if (!scd_cdda_fading)
+        return 0;
+
+    elapsed = getSubTick() - scd_cdda_fade_start;
+    if (elapsed >= scd_cdda_fade_len) {
+        vol = scd_cdda_fade_to;
+        stop = scd_cdda_fading == 2;
+        scd_cdda_fading = 0;
+    } else {
+        // progress in 1/256 steps, elapsed << 8 would overflow past 2^24 subticks
+        if (scd_cdda_fade_len >= 1UL<<24)
+            elapsed /= scd_cdda_fade_len >> 8;
+        else
+            elapsed = (elapsed << 8) / scd_cdda_fade_len;
+        vol = scd_cdda_fade_from + (((s32)scd_cdda_fade_to - (s32)scd_cdda_fade_from) * (s32)elapsed >> 8);
+        stop = 0;
+    }
+
+    if (vol != scd_cdda_vol) {
+        scd_cmd_wait(scd_cmd_submit('V', (u32)vol<<16, 0, 0)); // SetVolume command
+        scd_cdda_vol = vol;
+    }
+    if (stop) {
+        scd_cdda_stop_track();
+        // back to the volume from before the fade, so the next track isn't silent
+        scd_cmd_wait(scd_cmd_submit('V', (u32)scd_cdda_fade_from<<16, 0, 0)); // SetVolume command
+        scd_cdda_vol = scd_cdda_fade_from;
+    }
+    return scd_cdda_fading;
+}
+
+void scd_cdda_get_timecode(scd_cdda_timecode_t *tc)
+{
+    u32 time = scd_cdda_time, len;
+    const scd_cdda_track_t *toc;
+    u8 first, last;
+
+    tc->track = scd_cdda_track;
+    tc->rel = 0;
+    tc->abs = 0;
+    if (!scd_cdda_track)
+        return;
+
+    if (!scd_cdda_paused)
+        time += getSubTick() - scd_cdda_clock;
+    tc->rel = time >> 10; // 76800 subticks, 75 frames per second
+
+    // the track table is only read if it's already cached, so this never blocks on the drive
+    if (scd_toc_first && scd_cdda_track >= scd_toc_first && scd_cdda_track <= scd_toc_last) {
+        toc = scd_cdda_get_toc(&first, &last);
+        len = toc[scd_cdda_track - 1].length;
+        if (len && tc->rel >= len)
+            tc->rel = scd_cdda_repeat ? tc->rel % len : len;
+        tc->abs = scd_msf_frames(toc[scd_cdda_track - 1].start) + tc->rel;
+    }
+}
+
+/* Other Functions */
+void scd_invalidate_file_cache(void)
+{
+    memset(scd_file_cache, 0, sizeof(scd_file_cache));
+    scd_file_cache_next = 0;
+}
+
+long long int scd_open_file(const char *name)
+{
+    int i;
+    u32 *r;
+    scd_file_cache_t *e;
+    char *scdfn = (char *)MD_MEM(0x600000); /* word ram on MD side (in 1M mode) */
+    union {
+        s32 lo[2];
+        long long int value;
+    } handle;
+
+    scd_disc_check(); // a cached handle points at sectors of the disc it was looked up on
+    for (i = 0, e = scd_file_cache; i < SCD_FILE_CACHE_SIZE; i++, e++) {
+        if (e->name[0] && !strcmp(e->name, name))
+            return e->handle;
+    }
+
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+    for (i = 0; name[i]; i++)
+        *scdfn++ = name[i];
+    *scdfn = 0;
+
+    scd_ticket_t t = scd_cmd_submit('F', 0x0C0000, 0, 0); /* word ram on CD side (in 1M mode) */
+    scd_cmd_wait(t);
+    r = scd_cmd_res(t);
+    handle.lo[0] = r[0];
+    handle.lo[1] = r[1];
+
+    if (handle.lo[0] >= 0 && i < SCD_FILE_NAME_LEN) {
+        e = scd_file_cache + scd_file_cache_next;
+        custom_memcpy(e->name, name, i+1);
+        e->handle = handle.value;
+        scd_file_cache_next = (scd_file_cache_next + 1) % SCD_FILE_CACHE_SIZE;
+    }
+    return handle.value;
+}
+
+// sends the data_len bytes already placed at the start of word RAM to the buffer
+static void scd_upload_word_ram(u16 buf_id, u32 data_len)
+{
+    scd_cmd_wait(scd_cmd_submit('B', // SfxCopyBuffer command
+        (u32)buf_id<<16, /* buf_id */
+        0x0C0000, /* word ram on CD side (in 1M mode) */
+        data_len)); /* sample length */
+    scd_buf_uploaded(buf_id, data_len);
+}
+
+// uploads the raw PCM in word RAM with its loop split off into the loop buffer passed to
+// scd_buf_set_loop, the loop is moved to the start of word RAM for the second upload
+static u8 scd_upload_word_ram_looped(u16 buf_id, u32 start, u32 end)
+{
+    u8 *scdWordRam = (u8 *)MD_MEM(0x600000);
+    u16 loop_buf = scd_buf_loop_buf[buf_id - 1];
+    u32 i;
+
+    if (loop_buf < 1 || loop_buf > SCD_MAX_BUFS || loop_buf == buf_id)
+        return 0; // no buffer to split the loop off into
+    scd_upload_word_ram(buf_id, start);
+    for (i = start; i < end; i++)
+        scdWordRam[i - start] = scdWordRam[i];
+    scd_upload_word_ram(loop_buf, end - start);
+    scd_buf_link[buf_id - 1] = loop_buf;
+    return 1;
+}
+
+static u16 scd_le16(const u8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static u32 scd_le32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+// returns the contents of the first chunk with the given id in a RIFF WAVE file or NULL
+static const u8 *scd_wav_chunk(const u8 *wav, u32 wav_len, const char *id, u32 *chunk_len)
+{
+    const u8 *p = wav + 12, *end = wav + wav_len;
+
+    if (wav_len < 12 || memcmp2(wav, "RIFF", 4) || memcmp2(wav + 8, "WAVE", 4))
+        return NULL;
+
+    while (p + 8 <= end) {
+        *chunk_len = scd_le32(p + 4);
+        if (!memcmp2(p, id, 4))
+            return p + 8;
+        p += 8 + ((*chunk_len + 1) & ~1);
+    }
+    return NULL;
+}
+
+// decodes both channels of a stereo IMA ADPCM WAV in a single pass into an
+// unsigned 8-bit stereo WAV in word RAM, which the driver plays on two hardware channels
+static u8 scd_upload_ima_stereo(u16 buf_id, const u8 *fmt, const u8 *data, u32 data_len)
+{
+    u8 *scdWordRam = (u8 *)MD_MEM(0x600000), *out = scdWordRam + 44;
+    u16 block_align = scd_le16(fmt + 12), spb = scd_le16(fmt + 18);
+    u32 frames = data_len / block_align * spb, len = 44 + frames * 2;
+    s32 pred[2];
+    s16 index[2];
+    u16 i, j, c, n, step, diff, b;
+    const u8 *blk;
+
+    if (!block_align || len > SCD_WORD_RAM_SIZE || block_align < 8 || (spb - 1) != (block_align - 8))
+        return 0;
+
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+
+    for (blk = data; blk + block_align <= data + data_len; blk += block_align) {
+        // block header: initial sample and step index for each channel
+        for (c = 0; c < 2; c++) {
+            pred[c] = (s16)scd_le16(blk + c*4);
+            index[c] = blk[c*4 + 2] > 88 ? 88 : blk[c*4 + 2];
+            *out++ = (pred[c] + 0x8000) >> 8;
+        }
+
+        // 4 bytes of left channel nibbles followed by 4 bytes of right channel nibbles
+        for (i = 8; i < block_align; i += 8) {
+            for (c = 0; c < 2; c++) {
+                for (j = 0; j < 8; j++) {
+                    b = blk[i + c*4 + (j >> 1)];
+                    n = (j & 1) ? b >> 4 : b & 15;
+
+                    step = scd_ima_steps[index[c]];
+                    diff = step >> 3;
+                    if (n & 4) diff += step;
+                    if (n & 2) diff += step >> 1;
+                    if (n & 1) diff += step >> 2;
+                    if (n & 8) {
+                        pred[c] -= diff;
+                        if (pred[c] < -32768) pred[c] = -32768;
+                    } else {
+                        pred[c] += diff;
+                        if (pred[c] > 32767) pred[c] = 32767;
+                    }
+                    index[c] += scd_ima_index[n & 7];
+                    if (index[c] < 0) index[c] = 0;
+                    else if (index[c] > 88) index[c] = 88;
+
+                    out[j*2 + c] = (pred[c] + 0x8000) >> 8;
+                }
+            }
+            out += 16;
+        }
+    }
+
+    // unsigned 8-bit stereo WAV header
+    memcpy(scdWordRam, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x02\0\0\0\0\0\0\0\0\0\x02\0\x08\0data", 40);
+    for (n = 0; n < 4; n++) {
+        scdWordRam[4 + n] = (len - 8) >> (n*8);
+        scdWordRam[24 + n] = scd_le32(fmt + 4) >> (n*8); // sample rate
+        scdWordRam[28 + n] = (scd_le32(fmt + 4) * 2) >> (n*8); // byte rate
+        scdWordRam[40 + n] = (frames * 2) >> (n*8);
+    }
+
+    scd_upload_word_ram(buf_id, len);
+    return 1;
+}
+
+// copies a WAV with the given fmt chunk and a slice of sample data to word RAM and uploads it,
+// the slice is copied as raw PCM if there's no fmt chunk
+static u8 scd_upload_slice(u16 buf_id, const u8 *fmt, u32 fmt_len, const u8 *pcm, u32 len)
+{
+    u8 *scdWordRam = (u8 *)MD_MEM(0x600000);
+    u32 hdr_len = 0;
+    u16 n;
+
+    if (fmt) {
+        fmt_len = (fmt_len + 1) & ~1;
+        hdr_len = 28 + fmt_len;
+    }
+    if (hdr_len + len > SCD_WORD_RAM_SIZE)
+        return 0; // would overrun the word RAM bank
+
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+    if (fmt) {
+        memcpy(scdWordRam, "RIFF\0\0\0\0WAVEfmt ", 16);
+        memcpy(scdWordRam + 20 + fmt_len, "data", 4);
+        for (n = 0; n < 4; n++) {
+            scdWordRam[4 + n] = (hdr_len + len - 8) >> (n*8);
+            scdWordRam[16 + n] = fmt_len >> (n*8);
+            scdWordRam[24 + fmt_len + n] = len >> (n*8);
+        }
+        custom_memcpy(scdWordRam + 20, fmt, fmt_len);
+    }
+    custom_memcpy(scdWordRam + hdr_len, pcm, len);
+    scd_upload_word_ram(buf_id, hdr_len + len);
+
+    if (fmt && scd_le16(fmt) == 0x11)
+        scd_buf_flags[buf_id - 1] |= SCD_BUF_IMA;
+    return 1;
+}
 
-int mystrlen(const char* string);
+// uploads a sample with loop points set by scd_buf_set_loop, or taken from the smpl chunk of the WAV file:
+// the driver always loops from the start of a buffer, so the sample is cut at the loop end and,
+// unless the loop starts at the first sample, the loop is split off into the loop buffer
+// passed to scd_buf_set_loop
+// returns 2 if the sample has no loop points
+static u8 scd_upload_looped(u16 buf_id, const u8 *data, u32 data_len, const u8 *fmt, u32 fmt_len)
+{
+    const u8 *pcm = data, *smpl;
+    u32 pcm_len = data_len, smpl_len, start, end, align = 1;
+    u16 loop_buf;
 
-static scd_cmd_t scd_cmds[MAX_SCD_CMDS];
-static s16 num_scd_cmds;
+    start = scd_buf_loop_start[buf_id - 1];
+    end = scd_buf_loop_end[buf_id - 1];
+    if (!end || (end == SCD_LOOP_SMPL && !fmt))
+        return 2; // no loop points were asked for, the sample is uploaded unchanged
+    if (fmt) {
+        pcm = scd_wav_chunk(data, data_len, "data", &pcm_len);
+        if (!pcm)
+            return 2;
+        if (end == SCD_LOOP_SMPL) {
+            end = 0;
+            smpl = scd_wav_chunk(data, data_len, "smpl", &smpl_len);
+            if (smpl && smpl_len >= 36 + 24 && scd_le32(smpl + 28)) {
+                start = scd_le32(smpl + 36 + 8);
+                end = scd_le32(smpl + 36 + 12) + 1; // the end in the smpl chunk is inclusive
+            }
+        }
+        align = scd_le16(fmt + 12); // block align
+        if (scd_le16(fmt) == 0x11) {
+            // IMA ADPCM blocks carry the decoder state, so loops can only start at a block
+            start /= scd_le16(fmt + 18);
+            end /= scd_le16(fmt + 18);
+        }
+    }
 
-static void scd_delay(void) SCD_CODE_ATTR;
-static char wait_cmd_ack(void) SCD_CODE_ATTR;
-static void wait_do_cmd(char cmd) SCD_CODE_ATTR;
+    start *= align;
+    end *= align;
+    if (end > pcm_len)
+        end = pcm_len;
+    if (start >= end)
+        return 2;
 
-/* Initialize Function */
-void scd_init_pcm(void)
-{
-    /*
-    * Initialize the PCM driver
-    */
-    wait_do_cmd('I');
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    if (!start)
+        return scd_upload_slice(buf_id, fmt, fmt_len, pcm, end); // the driver loops the whole buffer
+
+    loop_buf = scd_buf_loop_buf[buf_id - 1];
+    if (loop_buf < 1 || loop_buf > SCD_MAX_BUFS || loop_buf == buf_id)
+        return 0; // no buffer to split the loop off into
+    if (!scd_upload_slice(loop_buf, fmt, fmt_len, pcm + start, end - start)
+        || !scd_upload_slice(buf_id, fmt, fmt_len, pcm, start))
+        return 0;
+    scd_buf_link[buf_id - 1] = loop_buf;
+    return 1;
 }
 
-/* Core SCD Functions */
-static void scd_delay(void)
+u8 scd_upload_buf(u16 buf_id, const u8 *data, u32 data_len)
 {
-    int cnt = 5;
-    do {
-        asm __volatile("nop");
-    } while (--cnt);
+    u8 *scdWordRam = (u8 *)MD_MEM(0x600000);
+    const u8 *fmt, *pcm;
+    u32 fmt_len, pcm_len;
+    u8 res;
+
+    fmt = scd_wav_chunk(data, data_len, "fmt ", &fmt_len);
+    if (fmt && fmt_len >= 20 && scd_le16(fmt) == 0x11 && scd_le16(fmt + 2) == 2) {
+        // the driver only decodes mono IMA ADPCM
+        pcm = scd_wav_chunk(data, data_len, "data", &pcm_len);
+        return pcm && scd_upload_ima_stereo(buf_id, fmt, pcm, pcm_len);
+    }
+
+    if (buf_id >= 1 && buf_id <= SCD_MAX_BUFS) {
+        scd_buf_link[buf_id - 1] = 0;
+        res = scd_upload_looped(buf_id, data, data_len, fmt, fmt_len);
+        if (res != 2)
+            return res;
+    }
+
+    if (data_len > SCD_WORD_RAM_SIZE) {
+        return 0; // would overrun the word RAM bank
+    }
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+    custom_memcpy(scdWordRam, data, data_len);
+    scd_upload_word_ram(buf_id, data_len);
+
+    if (fmt && scd_le16(fmt) == 0x11 && buf_id >= 1 && buf_id <= SCD_MAX_BUFS)
+        scd_buf_flags[buf_id - 1] |= SCD_BUF_IMA;
+    return 1;
 }
 
-static char wait_cmd_ack(void)
+void scd_upload_buf_fileofs(u16 buf_id, int numsfx, const u8 *data)
 {
-    char ack = 0;
+    int i, filelen;
+    char *scdWordRam = (char *)MD_MEM(0x600000);
 
-    do {
-        scd_delay();
-        ack = read_byte(0xA1200F); // wait for acknowledge byte in sub comm port
-    } while (!ack);
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+
+    // copy filename
+    filelen = mystrlen((char *)data);
+    custom_memcpy(scdWordRam, data, filelen+1);
 
-    return ack;
+    // copy offsets and lengths
+    scdWordRam = (void *)(((unsigned long)scdWordRam + filelen + 1 + 3) & ~3);
+    data = (void *)(((unsigned long)data + filelen + 1 + 3) & ~3);
+    custom_memcpy(scdWordRam, data, numsfx*2*sizeof(int32_t));
+    for (i = 0; i < numsfx; i++)
+        scd_buf_uploaded(buf_id + i, ((const int32_t *)data)[i*2+1]);
+
+    scd_cmd_wait(scd_cmd_submit('K', // SfxCopyBuffer command
+        ((u32)buf_id<<16)|(numsfx & 0xffff), /* buf_id|num samples */
+        0x0C0000, /* word ram on CD side (in 1M mode) */
+        0));
 }
 
-static void wait_do_cmd(char cmd)
+/* Buffer Functions */
+static void scd_buf_uploaded(u16 buf_id, u32 data_len)
 {
-    while (read_byte(0xA1200F)) {
-        scd_delay(); // wait until Sub-CPU is ready to receive command
+    u16 i = buf_id - 1;
+
+    if (i >= SCD_MAX_BUFS)
+        return;
+
+    if (scd_buf_state[i] == SCD_BUF_UNUSED || data_len > scd_buf_len[i]) {
+        // the driver allocates a new block, an outgrown one is never returned to the pool
+        scd_pool_used += data_len;
+        scd_buf_len[i] = data_len;
     }
-    write_byte(0xA1200E, cmd); // set main comm port to command
+    scd_buf_state[i] = SCD_BUF_USED;
+    scd_buf_freq[i] = 0;
+    scd_buf_flags[i] = 0;
+    scd_buf_link[i] = 0;
 }
 
-int mystrlen(const char* string)
+u16 scd_alloc_buf(u32 data_len)
 {
-	volatile int rc = 0;
+    u16 i, best = SCD_MAX_BUFS, unused = SCD_MAX_BUFS;
 
-	while (*(string++))
-		rc++;
+    for (i = 0; i < SCD_MAX_BUFS; i++) {
+        if (scd_buf_state[i] == SCD_BUF_FREED) {
+            // best fit among the freed buffers
+            if (scd_buf_len[i] >= data_len && (best == SCD_MAX_BUFS || scd_buf_len[i] < scd_buf_len[best]))
+                best = i;
+        } else if (scd_buf_state[i] == SCD_BUF_UNUSED && unused == SCD_MAX_BUFS) {
+            unused = i;
+        }
+    }
 
-	return rc;
-}
+    if (best == SCD_MAX_BUFS) {
+        if (unused == SCD_MAX_BUFS || scd_pool_used + data_len > SCD_SAMPLE_POOL_SIZE)
+            return 0;
+        best = unused;
+    }
 
-/* SPCM Functions */
-void scd_spcm_play_track(const char *name, int repeat)
-{
-    char *scdWordRam = (char *)0x600000; /* word ram on MD side (in 1M mode) */
-    custom_memcpy(scdWordRam, name, mystrlen(name)+1);
-    write_long(0xA12010, 0x0C0000); /* word ram on CD side (in 1M mode) */
-    write_long(0xA12014, repeat);
-    wait_do_cmd('Q'); // PlaySPCMTrack command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    // reserve the buf_id until the data is uploaded
+    scd_buf_state[best] = SCD_BUF_USED;
+    if (scd_buf_len[best] < data_len) {
+        scd_pool_used += data_len;
+        scd_buf_len[best] = data_len;
+    }
+    return best + 1;
 }
 
-void scd_spcm_stop_track()
+void scd_free_buf(u16 buf_id)
 {
-    wait_do_cmd('R'); // StopSPCMTrack command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    u16 i = buf_id - 1;
+
+    if (i < SCD_MAX_BUFS && scd_buf_state[i] == SCD_BUF_USED) {
+        scd_buf_state[i] = SCD_BUF_FREED;
+        scd_buf_link[i] = 0;
+    }
 }
 
-void scd_spcm_resume_track(void)
+void scd_buf_set_ima(u16 buf_id, u8 ima)
 {
-    wait_do_cmd('X'); // ResumeSPCMTrack command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    if (buf_id < 1 || buf_id > SCD_MAX_BUFS)
+        return;
+    if (ima)
+        scd_buf_flags[buf_id - 1] |= SCD_BUF_IMA;
+    else
+        scd_buf_flags[buf_id - 1] &= ~SCD_BUF_IMA;
 }
 
-int scd_spcm_get_playback_status(void)
+void scd_buf_set_loop(u16 buf_id, u32 loop_start, u32 loop_end, u16 loop_buf_id)
 {
-    return read_byte(0xA1202E);
+    if (buf_id < 1 || buf_id > SCD_MAX_BUFS)
+        return;
+    scd_buf_loop_start[buf_id - 1] = loop_start;
+    scd_buf_loop_end[buf_id - 1] = loop_end;
+    scd_buf_loop_buf[buf_id - 1] = loop_buf_id;
 }
 
-/* CDDA Functions */
-long long int scd_get_disc_info(void)
+int scd_run_loops(void)
 {
-    union {
-        s16 lo[4];
-        long long int value;
-    } res;
+    u8 i, mask, n = 0;
+    u16 loop_buf;
+    scd_src_state_t *src;
+    scd_src_shadow_t *shadow;
+    scd_ramp_t ramps[SCD_NUM_RAMP_PARAMS];
 
-    wait_do_cmd('D'); // GetDiscInfo command
-    wait_cmd_ack();
-    res.lo[0] = read_word(0xA12020); // status
-    res.lo[1] = read_word(0xA12022); // first and last song
-    res.lo[2] = read_word(0xA12024); // drive version, flag 
-    res.lo[3] = 0;
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_poll(); // moves loop plays submitted by the previous call along
 
-    return res.value;
-}
+    mask = read_byte(0xA1202F);
+    for (i = 0, src = scd_srcs, shadow = scd_src_shadow; i < SCD_MAX_SRCS; i++, src++, shadow++) {
+        if (!src->loop_buf || !src->buf_id || src->paused || !shadow->valid)
+            continue;
+        if (mask & (1 << i)) {
+            src->intro_seen = 1;
+            continue;
+        }
+        if (!src->intro_seen)
+            continue; // the driver may not have set the mask bit for the intro yet
 
-long long int scd_cdda_get_track_info(u16 track)
-{
-    union {
-        s32 lo[2];
-        long long int value;
-    } res;
+        if (scd_async_next != scd_async_done) {
+            // a pending command might still stop or restart the source
+            scd_cmd_wait_all();
+            if (!src->loop_buf || !src->buf_id || src->paused || !src->intro_seen || !shadow->valid)
+                continue;
+        }
 
-    write_word(0xA12010, track);
-    wait_do_cmd('T'); // GetTrackInfo command
-    wait_cmd_ack();
-    res.lo[0] = read_long(0xA12020); // MMSSFFTN minutes|seconds|frames|track number|
-    res.lo[1] = read_byte(0xA12024) & 0xff; // track type - DATA or CDDA (byte)
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+        // the intro has ended, the ramps of the source carry on into the loop
+        loop_buf = src->loop_buf;
+        src->loop_buf = 0;
+        memcpy(ramps, scd_ramps[i], sizeof(ramps));
+        scd_src_play_async(i + 1, loop_buf, shadow->freq, shadow->pan, shadow->vol, 1);
+        memcpy(scd_ramps[i], ramps, sizeof(ramps));
+        n++;
+    }
 
-    return res.value;
+    if (n)
+        scd_cmd_poll();
+    return n;
 }
 
-void scd_cdda_play_track(u16 track, u16 repeat)
+void scd_get_mem_info(scd_mem_info_t *info)
 {
-    write_word(0xA12010, track);
-    write_byte(0xA12012, repeat);
-    wait_do_cmd('P'); // PlayTrack command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
-}
+    u16 i;
 
-void scd_cdda_stop_track(void)
-{
-    wait_do_cmd('S'); // StopPlaying command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    memset(info, 0, sizeof(*info));
+    info->pool_size = SCD_SAMPLE_POOL_SIZE;
+    info->pool_free = scd_pool_used < SCD_SAMPLE_POOL_SIZE ? SCD_SAMPLE_POOL_SIZE - scd_pool_used : 0;
+
+    for (i = 0; i < SCD_MAX_BUFS; i++) {
+        if (scd_buf_state[i] == SCD_BUF_USED) {
+            info->used += scd_buf_len[i];
+            info->num_used++;
+        } else if (scd_buf_state[i] == SCD_BUF_FREED) {
+            info->freed += scd_buf_len[i];
+            if (scd_buf_len[i] > info->largest_freed)
+                info->largest_freed = scd_buf_len[i];
+        }
+    }
+
+    info->largest_free = info->pool_free > info->largest_freed ? info->pool_free : info->largest_freed;
+    if (info->pool_free + info->freed)
+        info->fragmentation = 100 - (u32)info->largest_free * 100 / (info->pool_free + info->freed);
 }
 
-void scd_cdda_toggle_pause(void)
+static u32 scd_be32(const u8 *p)
 {
-    wait_do_cmd('Z'); // PauseResume command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
 }
 
-void scd_cdda_set_volume(u16 volume)
+static void scd_dpcm4_decode(const u8 *in, u32 num, u8 *out)
 {
-    write_word(0xA12010, volume);
-    wait_do_cmd('V'); // StopSPCMTrack command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    u8 b, smp = 0x80;
+
+    while (num--) {
+        b = *in++;
+        smp += scd_dpcm4_deltas[b >> 4];
+        *out++ = smp;
+        smp += scd_dpcm4_deltas[b & 15];
+        *out++ = smp;
+    }
 }
 
-/* Other Functions */
-long long int scd_open_file(const char *name)
+u8 scd_upload_native(u16 buf_id, const u8 *data)
 {
-    int i;
-    char *scdfn = (char *)0x600000; /* word ram on MD side (in 1M mode) */
-    union {
-        s32 lo[2];
-        long long int value;
-    } handle;
+    u8 *scdWordRam = (u8 *)MD_MEM(0x600000);
+    u32 data_len = scd_be32(data + 4);
+    u32 len, start = 0, end = 0;
 
-    for (i = 0; name[i]; i++)
-        *scdfn++ = name[i];
-    *scdfn = 0;
+    if (memcmp2(data, "SCDN", 4) || data[11] != 1)
+        return 0;
 
-    write_long(0xA12010, 0x0C0000); /* word ram on CD side (in 1M mode) */
-    wait_do_cmd('F');
-    wait_cmd_ack();
-    handle.lo[0] = read_long(0xA12020);
-    handle.lo[1] = read_long(0xA12024);
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
-    return handle.value;
-}
+    switch (data[10]) {
+        case SCD_CODEC_PCM_U8:
+            len = data_len;
+            break;
+        case SCD_CODEC_DPCM4:
+            len = data_len*2;
+            break;
+        default:
+            return 0;
+    }
+    if (len > SCD_WORD_RAM_SIZE)
+        return 0; // would overrun the word RAM bank
 
-void scd_upload_buf(u16 buf_id, const u8 *data, u32 data_len)
-{
-    u8 *scdWordRam = (u8 *)0x600000;
-    custom_memcpy(scdWordRam, data, data_len);
-    write_word(0xA12010, buf_id); /* buf_id */
-    write_long(0xA12014, 0x0C0000); /* word ram on CD side (in 1M mode) */
-    write_long(0xA12018, data_len); /* sample length */
-    wait_do_cmd('B'); // SfxCopyBuffer command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    if (buf_id >= 1 && buf_id <= SCD_MAX_BUFS) {
+        start = scd_buf_loop_start[buf_id - 1];
+        end = scd_buf_loop_end[buf_id - 1];
+        if (end == SCD_LOOP_SMPL) {
+            // the loop stored by the tools runs from loop_start to the end of the sample
+            start = scd_be32(data + 12);
+            end = start == SCD_NO_LOOP ? 0 : len;
+        }
+        if (end > len)
+            end = len;
+        if (start >= end)
+            end = 0;
+    }
+
+    scd_cmd_wait_all(); // word ram might still be in use by a pending command
+    if (data[10] == SCD_CODEC_DPCM4)
+        scd_dpcm4_decode(data + SCD_NATIVE_HDR_SIZE, data_len, scdWordRam);
+    else
+        custom_memcpy(scdWordRam, data + SCD_NATIVE_HDR_SIZE, data_len);
+    if (!end || !start) {
+        scd_upload_word_ram(buf_id, end ? end : len); // the driver loops the whole buffer
+    } else if (!scd_upload_word_ram_looped(buf_id, start, end)) {
+        return 0;
+    }
+
+    if (buf_id >= 1 && buf_id <= SCD_MAX_BUFS) {
+        scd_buf_freq[buf_id - 1] = (data[8] << 8) | data[9];
+        if (scd_buf_link[buf_id - 1])
+            scd_buf_freq[scd_buf_link[buf_id - 1] - 1] = scd_buf_freq[buf_id - 1];
+    }
+    return 1;
 }
 
-void scd_upload_buf_fileofs(u16 buf_id, int numsfx, const u8 *data)
+void scd_src_load_native_file(const char *filename, int buf_id, u16 freq)
 {
-    int filelen;
-    char *scdWordRam = (char *)0x600000;
+    int l = scd_open_file(filename) >> 32;
+    if (l < SCD_NATIVE_HDR_SIZE) {
+        return;
+    }
 
-    // copy filename
-    filelen = mystrlen((char *)data);
-    custom_memcpy(scdWordRam, data, filelen+1);
+    char buf[1000], *ptr;
+    int offsetlen[2];
 
-    // copy offsets and lengths
-    scdWordRam = (void *)(((u32)scdWordRam + filelen + 1 + 3) & ~3);
-    data = (void *)(((u32)data + filelen + 1 + 3) & ~3);
-    custom_memcpy(scdWordRam, data, numsfx*2*sizeof(int32_t));
+    offsetlen[0] = SCD_NATIVE_HDR_SIZE; // skip the header, the rest is raw PCM
+    offsetlen[1] = l - SCD_NATIVE_HDR_SIZE;
+
+    custom_memcpy(buf, filename, strlen(filename)+1);
+    ptr = (void*)(((unsigned long)buf + strlen(filename) + 1 + 3) & ~3);
+    custom_memcpy(ptr, offsetlen, sizeof(offsetlen));
 
-    write_word(0xA12010, buf_id); /* buf_id */
-    write_word(0xA12012, numsfx); /* num samples */
-    write_long(0xA12014, 0x0C0000); /* word ram on CD side (in 1M mode) */
-    wait_do_cmd('K'); // SfxCopyBuffer command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_upload_buf_fileofs(buf_id, 1, (const u8 *)buf);
+    if (buf_id >= 1 && buf_id <= SCD_MAX_BUFS)
+        scd_buf_freq[buf_id - 1] = freq;
 }
 
 void scd_src_load_file(const char *filename, int sfx_id)
@@ -244,75 +1726,80 @@ void scd_src_load_file(const char *filename, int sfx_id)
     offsetlen[1] = l;
 
     custom_memcpy(buf, filename, strlen(filename)+1);
-    ptr = (void*)(((u32)buf + strlen(filename) + 1 + 3) & ~3);
+    ptr = (void*)(((unsigned long)buf + strlen(filename) + 1 + 3) & ~3);
     custom_memcpy(ptr, offsetlen, sizeof(offsetlen));
 
     scd_upload_buf_fileofs(sfx_id, 1, (const u8 *)buf);
 }
 
+u16 scd_load_bank(u16 buf_id, const u8 *index)
+{
+    u32 count = scd_be32(index + 4);
+    u16 i;
+    int filelen;
+    const u8 *src;
+    char buf[1000];
+    int32_t *offsetlen;
+
+    if (memcmp2(index, "SCDB", 4))
+        return 0;
+    if (!count || buf_id < 1 || buf_id > SCD_MAX_BUFS || count > (u32)(SCD_MAX_BUFS - buf_id + 1))
+        return 0; // the samples wouldn't fit in consecutive buffers
+
+    filelen = mystrlen((const char *)index + 8);
+    src = index + 8 + ((filelen + 1 + 3) & ~3);
+
+    custom_memcpy(buf, index + 8, filelen+1);
+    offsetlen = (void*)(((unsigned long)buf + filelen + 1 + 3) & ~3);
+    if ((char *)(offsetlen + count*2) > buf + sizeof(buf))
+        return 0;
+
+    for (i = 0; i < count*2; i++, src += 4)
+        offsetlen[i] = scd_be32(src);
+
+    // all samples are read from the bank file in a single request
+    scd_upload_buf_fileofs(buf_id, count, (const u8 *)buf);
+    return count;
+}
+
 u8 scd_src_play(u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
 {
-    write_long(0xA12010, ((unsigned)src_id<<16)|buf_id); /* src|buf_id */
-    write_long(0xA12014, ((unsigned)freq<<16)|pan); /* freq|pan */
-    write_long(0xA12018, ((unsigned)vol<<16)|autoloop); /* vol|autoloop */
-    wait_do_cmd('A'); // SfxPlaySource command
-    wait_cmd_ack();
-    src_id = read_byte(0xA12020);
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
-    return src_id;
+    scd_ticket_t t = scd_src_play_async(src_id, buf_id, freq, pan, vol, autoloop);
+    scd_cmd_wait(t);
+    return scd_src_play_result(t);
 }
 
 u8 scd_src_toggle_pause(u8 src_id, u8 paused)
 {
-    write_long(0xA12010, ((unsigned)src_id<<16)|paused); /* src|paused */
-    wait_do_cmd('N'); // SfxPUnPSource command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_wait(scd_cmd_submit('N', ((unsigned)src_id<<16)|paused, 0, 0)); // SfxPUnPSource command
     return src_id;
 }
 
 void scd_src_update(u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
 {
-    write_long(0xA12010, ((unsigned)src_id<<16)); /* src|0 */
-    write_long(0xA12014, ((unsigned)freq<<16)|pan); /* freq|pan */
-    write_long(0xA12018, ((unsigned)vol<<16)|autoloop); /* vol|autoloop */
-    wait_do_cmd('U'); // SfxUpdateSource command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_wait(scd_src_update_async(src_id, freq, pan, vol, autoloop));
 }
 
 u16 scd_src_get_pos(u8 src_id)
 {
-    u16 pos;
-    write_long(0xA12010, src_id<<16);
-    wait_do_cmd('G'); // SfxGetSourcePosition command
-    wait_cmd_ack();
-    pos = read_word(0xA12020);
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
-    return pos;
+    scd_ticket_t t = scd_src_get_pos_async(src_id);
+    scd_cmd_wait(t);
+    return scd_src_get_pos_result(t);
 }
 
 void scd_src_stop(u8 src_id)
 {
-    write_long(0xA12010, ((unsigned)src_id<<16)); /* src|0 */
-    wait_do_cmd('O'); // SfxStopSource command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_wait(scd_src_stop_async(src_id));
 }
 
 void scd_src_rewind(u8 src_id)
 {
-    write_long(0xA12010, ((unsigned)src_id<<16)); /* src|0 */
-    wait_do_cmd('W'); // SfxRewindSource command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_wait(scd_cmd_submit('W', ((unsigned)src_id<<16), 0, 0)); // SfxRewindSource command
 }
 
 void scd_clear_pcm(void)
 {
-    wait_do_cmd('L'); // SfxClear command
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    scd_cmd_wait(scd_cmd_submit('L', 0, 0, 0)); // SfxClear command
 }
 
 int scd_get_playback_status(void)
@@ -370,45 +1857,330 @@ void scd_queue_clear_pcm(void)
     num_scd_cmds++;
 }
 
+// drops queued commands whose effect is overridden by a later command in the queue
+// returns the new number of queued commands
+static s16 scd_coalesce_cmd_queue(void)
+{
+    s16 i, j, n;
+    u8 touched = 0; // sources affected by commands kept so far
+    scd_cmd_t *cmd, *next;
+
+    // a clear stops all sources, nothing queued before it has any effect
+    for (i = num_scd_cmds - 1; i > 0; i--) {
+        if (scd_cmds[i].cmd == 'L')
+            break;
+    }
+
+    for (n = 0; i < num_scd_cmds; i++) {
+        cmd = scd_cmds + i;
+
+        if ((cmd->cmd == 'A' || cmd->cmd == 'U' || cmd->cmd == 'S') && cmd->arg[0] != 255) {
+            for (j = i + 1, next = cmd + 1; j < num_scd_cmds; j++, next++) {
+                if (next->cmd == 'L' || next->arg[0] != cmd->arg[0])
+                    continue;
+                if (next->cmd == 'A' || next->cmd == 'S')
+                    break; // restarted or stopped later on
+                if (next->cmd == 'U' && cmd->cmd == 'U')
+                    break; // updated again later on
+                j = num_scd_cmds;
+                break;
+            }
+            if (j < num_scd_cmds)
+                continue;
+        }
+
+        if (cmd->cmd == 'U' && cmd->arg[0] >= 1 && cmd->arg[0] <= SCD_MAX_SRCS) {
+            // sent as is, unless an earlier command in the queue changes the source first
+            if (!(touched & (1 << (cmd->arg[0] - 1)))
+                && scd_src_update_redundant(cmd->arg[0], cmd->arg[1], cmd->arg[2], cmd->arg[3], cmd->arg[4]))
+                continue;
+        }
+        if (cmd->cmd == 'L' || cmd->arg[0] == 255)
+            touched = 0xff;
+        else if (cmd->arg[0] >= 1 && cmd->arg[0] <= SCD_MAX_SRCS)
+            touched |= 1 << (cmd->arg[0] - 1);
+
+        if (n != i)
+            scd_cmds[n] = *cmd;
+        n++;
+    }
+
+    scd_stat_cmds_avoided += num_scd_cmds - n;
+    return n;
+}
+
 int scd_flush_cmd_queue(void)
 {
-    int i;
+    int i, n;
     scd_cmd_t *cmd;
 
     if (!num_scd_cmds) {
         return 0;
     }
 
-    write_byte(0xA12010, 1);
-    wait_do_cmd('E'); // suspend the mixer/decoder
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    n = scd_coalesce_cmd_queue();
 
-    for (i = 0, cmd = scd_cmds; i < num_scd_cmds; i++, cmd++) {
+    // a single command is applied atomically anyway
+    if (n > 1)
+        scd_cmd_submit('E', 1<<24, 0, 0); // suspend the mixer/decoder
+
+    for (i = 0, cmd = scd_cmds; i < n; i++, cmd++) {
         switch (cmd->cmd) {
             case 'A':
-                scd_src_play(cmd->arg[0], cmd->arg[1], cmd->arg[2], cmd->arg[3], cmd->arg[4], cmd->arg[5]);
+                scd_src_play_async(cmd->arg[0], cmd->arg[1], cmd->arg[2], cmd->arg[3], cmd->arg[4], cmd->arg[5]);
                 break;
             case 'U':
-                scd_src_update(cmd->arg[0], cmd->arg[1], cmd->arg[2], cmd->arg[3], cmd->arg[4]);
+                scd_src_update_async(cmd->arg[0], cmd->arg[1], cmd->arg[2], cmd->arg[3], cmd->arg[4]);
                 break;
             case 'S':
-                scd_src_stop(cmd->arg[0]);
+                scd_src_stop_async(cmd->arg[0]);
                 break;
             case 'L':
-                scd_clear_pcm();
+                scd_cmd_submit('L', 0, 0, 0); // SfxClear command
                 break;
             default:
                 break;
         }
     }
 
-    write_byte(0xA12010, 0);
-    wait_do_cmd('E'); // unsuspend
-    wait_cmd_ack();
-    write_byte(0xA1200E, 0x00); // acknowledge receipt of command result
+    if (n > 1)
+        scd_cmd_submit('E', 0, 0, 0); // unsuspend
+    scd_cmd_wait_all();
 
     num_scd_cmds = 0;
-    return i;
+    return n;
+}
+
+/* Ramp Functions */
+static void scd_ramp_start(u8 src_id, u8 param, const scd_env_point_t *points, u8 num_points, u8 sustain)
+{
+    scd_ramp_t *r;
+    scd_src_shadow_t *shadow;
+
+    if (src_id < 1 || src_id > SCD_MAX_SRCS || (param & ~SCD_RAMP_STOP) >= SCD_NUM_RAMP_PARAMS)
+        return;
+
+    r = &scd_ramps[src_id - 1][param & ~SCD_RAMP_STOP];
+    shadow = scd_src_shadow + src_id - 1;
+    if (!num_points || !shadow->valid) {
+        r->flags = 0;
+        return;
+    }
+
+    r->env = points;
+    r->num_points = num_points;
+    r->sustain = sustain;
+    r->point = 0;
+    r->start = getSubTick();
+    r->duration = r->env[0].duration;
+    r->to = r->env[0].value;
+    switch (param & ~SCD_RAMP_STOP) {
+        case SCD_RAMP_VOL:
+            r->from = shadow->vol;
+            break;
+        case SCD_RAMP_PAN:
+            r->from = shadow->pan;
+            break;
+        default:
+            // a frequency of 0 means the WAV file rate, which isn't known here
+            r->from = shadow->freq ? shadow->freq : r->to;
+            break;
+    }
+    r->flags = SCD_RAMP_ACTIVE | ((param & SCD_RAMP_STOP) ? SCD_RAMP_STOPS : 0);
+}
+
+// advances a ramp to now and returns its current value
+static u16 scd_ramp_step(scd_ramp_t *r, u32 now, u8 *stop)
+{
+    u32 elapsed = now - r->start;
+
+    while (elapsed >= r->duration) {
+        if (r->point == r->sustain && !(r->flags & SCD_RAMP_RELEASED))
+            return r->to; // hold until released
+
+        if (r->point + 1 >= r->num_points) {
+            if (r->flags & SCD_RAMP_STOPS)
+                *stop = 1;
+            r->flags = 0;
+            return r->to;
+        }
+
+        elapsed -= r->duration;
+        r->start += r->duration;
+        r->point++;
+        r->from = r->to;
+        r->to = r->env[r->point].value;
+        r->duration = r->env[r->point].duration;
+    }
+
+    // progress in 1/256 steps, elapsed << 8 would overflow past 2^24 subticks
+    if (r->duration >= 1UL<<24)
+        elapsed /= r->duration >> 8;
+    else
+        elapsed = (elapsed << 8) / r->duration;
+    return r->from + (((s32)r->to - (s32)r->from) * (s32)elapsed >> 8);
+}
+
+void scd_src_ramp(u8 src_id, u8 param, u16 target, u32 duration)
+{
+    scd_ramp_t *r;
+
+    if (src_id < 1 || src_id > SCD_MAX_SRCS || (param & ~SCD_RAMP_STOP) >= SCD_NUM_RAMP_PARAMS)
+        return;
+
+    if ((param & ~SCD_RAMP_STOP) != SCD_RAMP_FREQ && target > 255)
+        target = 255; // volume and pan are 8-bit
+    r = &scd_ramps[src_id - 1][param & ~SCD_RAMP_STOP];
+    r->single.value = target;
+    r->single.duration = duration;
+    scd_ramp_start(src_id, param, &r->single, 1, SCD_ENV_NO_SUSTAIN);
+}
+
+void scd_src_set_envelope(u8 src_id, u8 param, const scd_env_point_t *points, u8 num_points, u8 sustain)
+{
+    scd_ramp_start(src_id, param, points, num_points, sustain);
+}
+
+void scd_src_release(u8 src_id)
+{
+    u8 i;
+    scd_ramp_t *r;
+    u32 now = getSubTick();
+
+    if (src_id < 1 || src_id > SCD_MAX_SRCS)
+        return;
+
+    for (i = 0, r = scd_ramps[src_id - 1]; i < SCD_NUM_RAMP_PARAMS; i++, r++) {
+        if (!(r->flags & SCD_RAMP_ACTIVE) || (r->flags & SCD_RAMP_RELEASED))
+            continue;
+        r->flags |= SCD_RAMP_RELEASED;
+        if (r->point == r->sustain && now - r->start >= r->duration)
+            r->start = now - r->duration; // the release segment starts now
+    }
+}
+
+void scd_src_stop_ramps(u8 src_id)
+{
+    if (src_id >= 1 && src_id <= SCD_MAX_SRCS)
+        memset(scd_ramps[src_id - 1], 0, sizeof(scd_ramps[0]));
+}
+
+int scd_run_ramps(void)
+{
+    u8 i, j, stop, active;
+    u16 v[SCD_NUM_RAMP_PARAMS];
+    u32 now = getSubTick();
+    scd_ramp_t *r;
+    scd_src_shadow_t *shadow;
+
+    for (i = 0, shadow = scd_src_shadow; i < SCD_MAX_SRCS; i++, shadow++) {
+        v[SCD_RAMP_VOL] = shadow->vol;
+        v[SCD_RAMP_PAN] = shadow->pan;
+        v[SCD_RAMP_FREQ] = shadow->freq;
+        stop = 0;
+        active = 0;
+
+        for (j = 0, r = scd_ramps[i]; j < SCD_NUM_RAMP_PARAMS; j++, r++) {
+            if (!(r->flags & SCD_RAMP_ACTIVE))
+                continue;
+            v[j] = scd_ramp_step(r, now, &stop);
+            if (j != SCD_RAMP_FREQ && v[j] > 255)
+                v[j] = 255; // envelope points above the 8-bit range
+            active = 1;
+        }
+
+        if (!active || !shadow->valid)
+            continue;
+
+        if (stop)
+            scd_queue_stop_src(i + 1);
+        else // unchanged values are dropped by the queue
+            scd_queue_update_src(i + 1, v[SCD_RAMP_FREQ], v[SCD_RAMP_PAN], v[SCD_RAMP_VOL], shadow->autoloop);
+    }
+
+    return scd_flush_cmd_queue();
+}
+
+/* Scheduled Functions */
+// inserts a command slot due at tick, after any command due at the same tick
+// returns NULL if the schedule is full
+static scd_cmd_t *scd_schedule(u32 tick)
+{
+    s16 i;
+
+    if (num_scd_sched_cmds >= SCD_MAX_SCHED_CMDS)
+        return NULL;
+
+    for (i = num_scd_sched_cmds; i > 0; i--) {
+        if ((s32)(scd_sched_cmds[i - 1].tick - tick) <= 0)
+            break;
+        scd_sched_cmds[i] = scd_sched_cmds[i - 1];
+    }
+
+    num_scd_sched_cmds++;
+    scd_sched_cmds[i].tick = tick;
+    return &scd_sched_cmds[i].cmd;
+}
+
+u8 scd_schedule_play_src(u32 tick, u8 src_id, u16 buf_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    scd_cmd_t *cmd = scd_schedule(tick);
+    if (!cmd)
+        return 0;
+    cmd->cmd = 'A';
+    cmd->arg[0] = src_id;
+    cmd->arg[1] = buf_id;
+    cmd->arg[2] = freq;
+    cmd->arg[3] = pan;
+    cmd->arg[4] = vol;
+    cmd->arg[5] = autoloop;
+    return 1;
+}
+
+u8 scd_schedule_update_src(u32 tick, u8 src_id, u16 freq, u8 pan, u8 vol, u8 autoloop)
+{
+    scd_cmd_t *cmd = scd_schedule(tick);
+    if (!cmd)
+        return 0;
+    cmd->cmd = 'U';
+    cmd->arg[0] = src_id;
+    cmd->arg[1] = freq;
+    cmd->arg[2] = pan;
+    cmd->arg[3] = vol;
+    cmd->arg[4] = autoloop;
+    return 1;
+}
+
+u8 scd_schedule_stop_src(u32 tick, u8 src_id)
+{
+    scd_cmd_t *cmd = scd_schedule(tick);
+    if (!cmd)
+        return 0;
+    cmd->cmd = 'S';
+    cmd->arg[0] = src_id;
+    return 1;
+}
+
+void scd_cancel_schedule(void)
+{
+    num_scd_sched_cmds = 0;
 }
 
+int scd_run_schedule(void)
+{
+    s16 i, j;
+    u32 now = getSubTick();
+
+    // due commands join the command queue, so they're sent in a single suspended batch
+    for (i = 0; i < num_scd_sched_cmds && num_scd_cmds < MAX_SCD_CMDS; i++) {
+        if ((s32)(scd_sched_cmds[i].tick - now) > 0)
+            break;
+        scd_cmds[num_scd_cmds++] = scd_sched_cmds[i].cmd;
+    }
+
+    for (j = 0; i < num_scd_sched_cmds; i++, j++)
+        scd_sched_cmds[j] = scd_sched_cmds[i];
+    num_scd_sched_cmds = j;
+
+    return scd_flush_cmd_queue();
+}
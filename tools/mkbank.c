@@ -0,0 +1,104 @@
+/*
+ * mkbank - packs sample files into a single bank file for the CD, each
+ * sample starting on a 2048 byte sector boundary, and writes the matching
+ * index for scd_load_bank
+ *
+ * Build: gcc -O2 -o mkbank mkbank.c
+ * Usage: mkbank output.bnk output.idx input1.wav [input2.wav ...]
+ *
+ * The file name stored in the index is the upper-cased name of output.bnk,
+ * which is how it has to appear in the ISO9660 filesystem
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define SECTOR_SIZE 2048
+#define MAX_SAMPLES 100
+
+static void wr32be(FILE *f, unsigned v)
+{
+    fputc(v >> 24, f);
+    fputc(v >> 16, f);
+    fputc(v >> 8, f);
+    fputc(v, f);
+}
+
+int main(int argc, char **argv)
+{
+    static unsigned char buf[SECTOR_SIZE];
+    unsigned ofs[MAX_SAMPLES], len[MAX_SAMPLES], pos = 0;
+    const char *name;
+    char cdname[256];
+    int i, n, count;
+    FILE *out, *in, *idx;
+
+    if (argc < 4) {
+        fprintf(stderr, "usage: mkbank output.bnk output.idx input1.wav [input2.wav ...]\n");
+        return 1;
+    }
+    count = argc - 3;
+    if (count > MAX_SAMPLES) {
+        fprintf(stderr, "at most %d samples per bank\n", MAX_SAMPLES);
+        return 1;
+    }
+
+    out = fopen(argv[1], "wb");
+    if (!out) {
+        fprintf(stderr, "%s: can't create\n", argv[1]);
+        return 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        in = fopen(argv[i + 3], "rb");
+        if (!in) {
+            fprintf(stderr, "%s: can't open\n", argv[i + 3]);
+            return 1;
+        }
+
+        ofs[i] = pos;
+        len[i] = 0;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+            len[i] += n;
+        }
+        fclose(in);
+
+        // pad to the next sector so that every sample starts on a sector boundary
+        pos += len[i];
+        memset(buf, 0, sizeof(buf));
+        if (pos % SECTOR_SIZE) {
+            fwrite(buf, 1, SECTOR_SIZE - pos % SECTOR_SIZE, out);
+            pos += SECTOR_SIZE - pos % SECTOR_SIZE;
+        }
+    }
+    fclose(out);
+
+    name = strrchr(argv[1], '/');
+    name = name ? name + 1 : argv[1];
+    for (i = 0; name[i] && i < (int)sizeof(cdname) - 1; i++)
+        cdname[i] = toupper((unsigned char)name[i]);
+    cdname[i] = 0;
+
+    // index: "SCDB", sample count, NUL terminated file name padded to 4 bytes,
+    // then an offset and a length per sample, all big-endian
+    idx = fopen(argv[2], "wb");
+    if (!idx) {
+        fprintf(stderr, "%s: can't create\n", argv[2]);
+        return 1;
+    }
+    fwrite("SCDB", 1, 4, idx);
+    wr32be(idx, count);
+    fwrite(cdname, 1, strlen(cdname) + 1, idx);
+    for (i = strlen(cdname) + 1; i & 3; i++)
+        fputc(0, idx);
+    for (i = 0; i < count; i++) {
+        wr32be(idx, ofs[i]);
+        wr32be(idx, len[i]);
+    }
+    fclose(idx);
+
+    printf("%s: %d samples, %u bytes\n", cdname, count, pos);
+    return 0;
+}
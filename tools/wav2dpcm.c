@@ -0,0 +1,276 @@
+/*
+ * wav2dpcm - encodes a PCM WAV file to the 4-bit DPCM native sample format
+ * (codec SCD_CODEC_DPCM4) and decodes it back for verification
+ *
+ * Every nibble indexes a fixed delta table, high nibble first, starting from
+ * a value of 0x80. The encoder never picks a delta that leaves the unsigned
+ * 8-bit range, so the decoder needs no clamping and no multiplies. The
+ * decoder below is the bit-exact reference for scd_upload_native.
+ *
+ * With -l the first loop of the smpl chunk is stored as the loop start. The
+ * header has no loop end, so the sample is cut at the end of the loop.
+ *
+ * Build: gcc -O2 -o wav2dpcm wav2dpcm.c
+ * Usage: wav2dpcm [-l] input.wav output.scd
+ *        wav2dpcm -d input.scd output.wav
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCD_NATIVE_HDR_SIZE 16
+#define SCD_NO_LOOP 0xFFFFFFFF
+#define SCD_CODEC_DPCM4 1
+
+// must match scd_dpcm4_deltas in src/scd_pcm.c
+static const signed char deltas[16] = {
+    -64, -34, -21, -13, -8, -5, -3, -1, 0, 1, 3, 5, 8, 13, 21, 34
+};
+
+static unsigned rd16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned rd32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static unsigned rd32be(const unsigned char *p)
+{
+    return ((unsigned)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// the first loop of a smpl chunk, the end is made exclusive and cut to the sample length
+static int smpl_loop(const unsigned char *smpl, unsigned num, unsigned *start, unsigned *loop_end)
+{
+    if (!smpl || !rd32(smpl + 28))
+        return 0;
+    *start = rd32(smpl + 36 + 8);
+    *loop_end = rd32(smpl + 36 + 12) + 1;
+    if (*loop_end > num)
+        *loop_end = num;
+    return *start < *loop_end;
+}
+
+static void wr16(unsigned char *p, unsigned v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void wr32(unsigned char *p, unsigned v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void wr16be(unsigned char *p, unsigned v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void wr32be(unsigned char *p, unsigned v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static unsigned char *load_file(const char *name, long *len)
+{
+    FILE *f = fopen(name, "rb");
+    unsigned char *buf;
+
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(*len);
+    if (buf && fread(buf, 1, *len, f) != (size_t)*len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static int save_file(const char *name, const unsigned char *hdr, unsigned hdr_len, const unsigned char *data, unsigned len)
+{
+    FILE *f = fopen(name, "wb");
+
+    if (!f || fwrite(hdr, 1, hdr_len, f) != hdr_len || fwrite(data, 1, len, f) != len) {
+        fprintf(stderr, "%s: write failed\n", name);
+        return 1;
+    }
+    fclose(f);
+    return 0;
+}
+
+// reference decoder: num packed bytes to num*2 unsigned 8-bit samples
+static void dpcm4_decode(const unsigned char *in, unsigned num, unsigned char *out)
+{
+    unsigned char s = 0x80;
+
+    while (num--) {
+        s += deltas[*in >> 4];
+        *out++ = s;
+        s += deltas[*in++ & 15];
+        *out++ = s;
+    }
+}
+
+static unsigned char dpcm4_nibble(unsigned char s, int target)
+{
+    int i, best = 8, err, best_err = 1 << 30;
+
+    for (i = 0; i < 16; i++) {
+        int v = s + deltas[i];
+        if (v < 0 || v > 255)
+            continue;
+        err = abs(v - target);
+        if (err < best_err) {
+            best_err = err;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int encode(const char *in_name, const char *out_name, int keep_loop)
+{
+    unsigned char *wav, *p, *end, *fmt = NULL, *data = NULL, *smpl = NULL, *out;
+    unsigned char hdr[SCD_NATIVE_HDR_SIZE], s = 0x80, n;
+    unsigned data_len = 0, rate, bits, num, i, loop_start = SCD_NO_LOOP, loop_end;
+    int target;
+    long len;
+
+    wav = load_file(in_name, &len);
+    if (!wav || len < 12 || memcmp(wav, "RIFF", 4) || memcmp(wav + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", in_name);
+        return 1;
+    }
+
+    for (p = wav + 12, end = wav + len; p + 8 <= end; p += 8 + ((rd32(p + 4) + 1) & ~1)) {
+        if (!memcmp(p, "fmt ", 4))
+            fmt = p + 8;
+        else if (!memcmp(p, "smpl", 4) && rd32(p + 4) >= 36 + 24 && p + 8 + 36 + 24 <= end)
+            smpl = p + 8;
+        else if (!memcmp(p, "data", 4)) {
+            data = p + 8;
+            data_len = rd32(p + 4);
+            if (data + data_len > end)
+                data_len = end - data;
+        }
+    }
+
+    if (!fmt || !data) {
+        fprintf(stderr, "%s: missing fmt or data chunk\n", in_name);
+        return 1;
+    }
+
+    rate = rd32(fmt + 4);
+    bits = rd16(fmt + 14);
+    if (rd16(fmt) != 1 || (bits != 8 && bits != 16) || rd16(fmt + 2) != 1 || rate > 32767) {
+        fprintf(stderr, "%s: only mono 8 or 16-bit PCM up to 32767 Hz is supported\n", in_name);
+        return 1;
+    }
+
+    // odd sample counts are padded with a zero delta
+    num = data_len / (bits / 8);
+    if (keep_loop) {
+        if (!smpl_loop(smpl, num, &loop_start, &loop_end)) {
+            fprintf(stderr, "%s: no loop in a smpl chunk\n", in_name);
+            return 1;
+        }
+        num = loop_end;
+    }
+    out = calloc((num + 1) / 2 + 1, 1);
+    for (i = 0; i < num; i++) {
+        if (bits == 8)
+            target = data[i];
+        else
+            target = (((signed char)data[i*2+1] << 8 | data[i*2]) + 32768 + 128) >> 8;
+        if (target > 255)
+            target = 255;
+        n = dpcm4_nibble(s, target);
+        s += deltas[n];
+        out[i >> 1] |= (i & 1) ? n : n << 4;
+    }
+    if (num & 1)
+        out[num >> 1] |= 8;
+    num = (num + 1) / 2;
+
+    memcpy(hdr, "SCDN", 4);
+    wr32be(hdr + 4, num);
+    wr16be(hdr + 8, rate);
+    hdr[10] = SCD_CODEC_DPCM4;
+    hdr[11] = 1; // channels
+    wr32be(hdr + 12, loop_start);
+
+    if (save_file(out_name, hdr, sizeof(hdr), out, num))
+        return 1;
+
+    printf("%s: %u samples at %u Hz, %u bytes", out_name, num * 2, rate, num);
+    if (loop_start != SCD_NO_LOOP)
+        printf(", loop from %u", loop_start);
+    printf("\n");
+    return 0;
+}
+
+static int decode(const char *in_name, const char *out_name)
+{
+    unsigned char *scd, *out, wav[44];
+    unsigned num, rate;
+    long len;
+
+    scd = load_file(in_name, &len);
+    if (!scd || len < SCD_NATIVE_HDR_SIZE || memcmp(scd, "SCDN", 4) || scd[10] != SCD_CODEC_DPCM4) {
+        fprintf(stderr, "%s: not a DPCM native sample\n", in_name);
+        return 1;
+    }
+
+    num = rd32be(scd + 4);
+    rate = (scd[8] << 8) | scd[9];
+    if (num > len - SCD_NATIVE_HDR_SIZE) {
+        fprintf(stderr, "%s: truncated\n", in_name);
+        return 1;
+    }
+
+    out = malloc(num * 2 + 1);
+    dpcm4_decode(scd + SCD_NATIVE_HDR_SIZE, num, out);
+
+    memcpy(wav, "RIFF", 4);
+    wr32(wav + 4, 36 + num * 2);
+    memcpy(wav + 8, "WAVEfmt ", 8);
+    wr32(wav + 16, 16);
+    wr16(wav + 20, 1); // PCM
+    wr16(wav + 22, 1); // mono
+    wr32(wav + 24, rate);
+    wr32(wav + 28, rate);
+    wr16(wav + 32, 1);
+    wr16(wav + 34, 8);
+    memcpy(wav + 36, "data", 4);
+    wr32(wav + 40, num * 2);
+
+    return save_file(out_name, wav, sizeof(wav), out, num * 2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && !strcmp(argv[1], "-d"))
+        return decode(argv[2], argv[3]);
+    if (argc == 4 && !strcmp(argv[1], "-l"))
+        return encode(argv[2], argv[3], 1);
+    if (argc == 3)
+        return encode(argv[1], argv[2], 0);
+
+    fprintf(stderr, "usage: wav2dpcm [-l] input.wav output.scd\n       wav2dpcm -d input.scd output.wav\n");
+    return 1;
+}
@@ -0,0 +1,161 @@
+/*
+ * wav2scd - converts a PCM WAV file to the native sample format of the
+ * Fusion driver: a 16 byte header followed by raw unsigned 8-bit PCM,
+ * which scd_upload_native uploads without the driver parsing a WAV header
+ *
+ * With -l the first loop of the smpl chunk is stored as the loop start. The header
+ * has no loop end, so the sample is cut at the end of the loop
+ *
+ * Build: gcc -O2 -o wav2scd wav2scd.c
+ * Usage: wav2scd [-l] input.wav output.scd
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCD_NATIVE_HDR_SIZE 16
+#define SCD_NO_LOOP 0xFFFFFFFF
+
+static unsigned rd16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned rd32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+// the first loop of a smpl chunk, the end is made exclusive and cut to the sample length
+static int smpl_loop(const unsigned char *smpl, unsigned num, unsigned *start, unsigned *loop_end)
+{
+    if (!smpl || !rd32(smpl + 28))
+        return 0;
+    *start = rd32(smpl + 36 + 8);
+    *loop_end = rd32(smpl + 36 + 12) + 1;
+    if (*loop_end > num)
+        *loop_end = num;
+    return *start < *loop_end;
+}
+
+static void wr16be(unsigned char *p, unsigned v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void wr32be(unsigned char *p, unsigned v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static unsigned char *load_file(const char *name, long *len)
+{
+    FILE *f = fopen(name, "rb");
+    unsigned char *buf;
+
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(*len);
+    if (buf && fread(buf, 1, *len, f) != (size_t)*len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char *wav, *p, *end, *fmt = NULL, *data = NULL, *smpl = NULL, *out;
+    unsigned char hdr[SCD_NATIVE_HDR_SIZE];
+    unsigned data_len = 0, rate, bits, channels, num, i, loop_start = SCD_NO_LOOP, loop_end;
+    int keep_loop = 0;
+    long len;
+    FILE *f;
+
+    if (argc == 4 && !strcmp(argv[1], "-l")) {
+        keep_loop = 1;
+        argc--;
+        argv++;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "usage: wav2scd [-l] input.wav output.scd\n");
+        return 1;
+    }
+
+    wav = load_file(argv[1], &len);
+    if (!wav || len < 12 || memcmp(wav, "RIFF", 4) || memcmp(wav + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", argv[1]);
+        return 1;
+    }
+
+    for (p = wav + 12, end = wav + len; p + 8 <= end; p += 8 + ((rd32(p + 4) + 1) & ~1)) {
+        if (!memcmp(p, "fmt ", 4))
+            fmt = p + 8;
+        else if (!memcmp(p, "smpl", 4) && rd32(p + 4) >= 36 + 24 && p + 8 + 36 + 24 <= end)
+            smpl = p + 8;
+        else if (!memcmp(p, "data", 4)) {
+            data = p + 8;
+            data_len = rd32(p + 4);
+            if (data + data_len > end)
+                data_len = end - data;
+        }
+    }
+
+    if (!fmt || !data) {
+        fprintf(stderr, "%s: missing fmt or data chunk\n", argv[1]);
+        return 1;
+    }
+
+    channels = rd16(fmt + 2);
+    rate = rd32(fmt + 4);
+    bits = rd16(fmt + 14);
+    if (rd16(fmt) != 1 || (bits != 8 && bits != 16) || channels != 1) {
+        fprintf(stderr, "%s: only mono 8 or 16-bit PCM is supported\n", argv[1]);
+        return 1;
+    }
+    if (rate > 32767) {
+        fprintf(stderr, "%s: sample rate %u is out of range\n", argv[1], rate);
+        return 1;
+    }
+
+    // 16-bit samples are signed, the driver expects unsigned 8-bit
+    num = data_len / (bits / 8);
+    if (keep_loop) {
+        if (!smpl_loop(smpl, num, &loop_start, &loop_end)) {
+            fprintf(stderr, "%s: no loop in a smpl chunk\n", argv[1]);
+            return 1;
+        }
+        num = loop_end;
+    }
+    out = malloc(num ? num : 1);
+    for (i = 0; i < num; i++)
+        out[i] = bits == 8 ? data[i] : (unsigned char)(data[i*2+1] ^ 0x80);
+
+    memcpy(hdr, "SCDN", 4);
+    wr32be(hdr + 4, num);
+    wr16be(hdr + 8, rate);
+    hdr[10] = 0; // codec: unsigned 8-bit PCM
+    hdr[11] = 1; // channels
+    wr32be(hdr + 12, loop_start);
+
+    f = fopen(argv[2], "wb");
+    if (!f || fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || fwrite(out, 1, num, f) != num) {
+        fprintf(stderr, "%s: write failed\n", argv[2]);
+        return 1;
+    }
+    fclose(f);
+
+    printf("%s: %u samples at %u Hz", argv[2], num, rate);
+    if (loop_start != SCD_NO_LOOP)
+        printf(", loop from %u", loop_start);
+    printf("\n");
+    return 0;
+}